@@ -23,12 +23,22 @@
 #endif
 
 #include "src/gstdabplusparse.h"
+#include "src/gstdabplusmultiparse.h"
+#include "src/gstdabpluscrc.h"
+#include "src/gstdabplusrs.h"
 
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
+  gst_dabplus_crc_init ();
+  gst_dabplus_rs_init ();
+
+  if (!gst_element_register (
+      plugin, "dabplusparse", GST_RANK_NONE, GST_TYPE_DABPLUSPARSE))
+    return FALSE;
+
   return gst_element_register (
-      plugin, "dabplusparse", GST_RANK_NONE, GST_TYPE_DABPLUSPARSE);
+      plugin, "dabplusmultiparse", GST_RANK_NONE, GST_TYPE_DABPLUSMULTIPARSE);
 }
 
 GST_PLUGIN_DEFINE (
@@ -0,0 +1,588 @@
+/* GStreamer DAB Plus firecode and CRC kernels
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Two checksums protect a DAB+ superframe (ETSI TS 102 563):
+ *  - the firecode (CRC-16, polynomial 0x782f) over bytes 2..10 of the
+ *    superframe header, which is also what the sync search looks for,
+ *  - the CRC-16 CCITT (polynomial 0x1021, initial value 0xffff, inverted)
+ *    at the end of every access unit.
+ *
+ * Each of them comes with a portable implementation and, on x86, with
+ * SIMD variants. The best variant for the running CPU is selected once by
+ * gst_dabplus_crc_init(), which is called from plugin_init.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstdabpluscrc.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DABPLUS_CRC_X86 1
+#include <immintrin.h>
+#endif
+
+#define CCITT_POLYNOMIAL       0x1021
+#define FIRECODE_WINDOW        (FIRECODE_LENGTH - 2)
+
+typedef gboolean (*GstDabPlusFindFirecodeFunc) (const guint8 * data,
+    guint from, guint to, guint * offset);
+typedef guint16 (*GstDabPlusCrcCcittFunc) (const guint8 * data, gsize size);
+
+typedef struct {
+  const gchar *find_firecode_name;
+  GstDabPlusFindFirecodeFunc find_firecode;
+  const gchar *crc_ccitt_name;
+  GstDabPlusCrcCcittFunc crc_ccitt;
+} GstDabPlusCrcKernels;
+
+/* The polynomial is: x^16 + x^14 + x^13 + x^12 + x^11 + x^5 + x^3 + x^2 + x + 1 */
+static const guint16 gst_dabplus_firecode_crc_table[256] = {
+  0x0000, 0x782f, 0xf05e, 0x8871, 0x9893, 0xe0bc, 0x68cd, 0x10e2,
+  0x4909, 0x3126, 0xb957, 0xc178, 0xd19a, 0xa9b5, 0x21c4, 0x59eb,
+  0x9212, 0xea3d, 0x624c, 0x1a63, 0x0a81, 0x72ae, 0xfadf, 0x82f0,
+  0xdb1b, 0xa334, 0x2b45, 0x536a, 0x4388, 0x3ba7, 0xb3d6, 0xcbf9,
+  0x5c0b, 0x2424, 0xac55, 0xd47a, 0xc498, 0xbcb7, 0x34c6, 0x4ce9,
+  0x1502, 0x6d2d, 0xe55c, 0x9d73, 0x8d91, 0xf5be, 0x7dcf, 0x05e0,
+  0xce19, 0xb636, 0x3e47, 0x4668, 0x568a, 0x2ea5, 0xa6d4, 0xdefb,
+  0x8710, 0xff3f, 0x774e, 0x0f61, 0x1f83, 0x67ac, 0xefdd, 0x97f2,
+  0xb816, 0xc039, 0x4848, 0x3067, 0x2085, 0x58aa, 0xd0db, 0xa8f4,
+  0xf11f, 0x8930, 0x0141, 0x796e, 0x698c, 0x11a3, 0x99d2, 0xe1fd,
+  0x2a04, 0x522b, 0xda5a, 0xa275, 0xb297, 0xcab8, 0x42c9, 0x3ae6,
+  0x630d, 0x1b22, 0x9353, 0xeb7c, 0xfb9e, 0x83b1, 0x0bc0, 0x73ef,
+  0xe41d, 0x9c32, 0x1443, 0x6c6c, 0x7c8e, 0x04a1, 0x8cd0, 0xf4ff,
+  0xad14, 0xd53b, 0x5d4a, 0x2565, 0x3587, 0x4da8, 0xc5d9, 0xbdf6,
+  0x760f, 0x0e20, 0x8651, 0xfe7e, 0xee9c, 0x96b3, 0x1ec2, 0x66ed,
+  0x3f06, 0x4729, 0xcf58, 0xb777, 0xa795, 0xdfba, 0x57cb, 0x2fe4,
+  0x0803, 0x702c, 0xf85d, 0x8072, 0x9090, 0xe8bf, 0x60ce, 0x18e1,
+  0x410a, 0x3925, 0xb154, 0xc97b, 0xd999, 0xa1b6, 0x29c7, 0x51e8,
+  0x9a11, 0xe23e, 0x6a4f, 0x1260, 0x0282, 0x7aad, 0xf2dc, 0x8af3,
+  0xd318, 0xab37, 0x2346, 0x5b69, 0x4b8b, 0x33a4, 0xbbd5, 0xc3fa,
+  0x5408, 0x2c27, 0xa456, 0xdc79, 0xcc9b, 0xb4b4, 0x3cc5, 0x44ea,
+  0x1d01, 0x652e, 0xed5f, 0x9570, 0x8592, 0xfdbd, 0x75cc, 0x0de3,
+  0xc61a, 0xbe35, 0x3644, 0x4e6b, 0x5e89, 0x26a6, 0xaed7, 0xd6f8,
+  0x8f13, 0xf73c, 0x7f4d, 0x0762, 0x1780, 0x6faf, 0xe7de, 0x9ff1,
+  0xb015, 0xc83a, 0x404b, 0x3864, 0x2886, 0x50a9, 0xd8d8, 0xa0f7,
+  0xf91c, 0x8133, 0x0942, 0x716d, 0x618f, 0x19a0, 0x91d1, 0xe9fe,
+  0x2207, 0x5a28, 0xd259, 0xaa76, 0xba94, 0xc2bb, 0x4aca, 0x32e5,
+  0x6b0e, 0x1321, 0x9b50, 0xe37f, 0xf39d, 0x8bb2, 0x03c3, 0x7bec,
+  0xec1e, 0x9431, 0x1c40, 0x646f, 0x748d, 0x0ca2, 0x84d3, 0xfcfc,
+  0xa517, 0xdd38, 0x5549, 0x2d66, 0x3d84, 0x45ab, 0xcdda, 0xb5f5,
+  0x7e0c, 0x0623, 0x8e52, 0xf67d, 0xe69f, 0x9eb0, 0x16c1, 0x6eee,
+  0x3705, 0x4f2a, 0xc75b, 0xbf74, 0xaf96, 0xd7b9, 0x5fc8, 0x27e7
+};
+
+/* Contribution of a byte followed by FIRECODE_LENGTH - 2 zero bytes to the firecode.
+   XOR-ing it out of a running firecode removes that byte from the front of the window. */
+static const guint16 gst_dabplus_firecode_rolling_table[256] = {
+  0x0000, 0x2804, 0x5008, 0x780c, 0xa010, 0x8814, 0xf018, 0xd81c,
+  0x380f, 0x100b, 0x6807, 0x4003, 0x981f, 0xb01b, 0xc817, 0xe013,
+  0x701e, 0x581a, 0x2016, 0x0812, 0xd00e, 0xf80a, 0x8006, 0xa802,
+  0x4811, 0x6015, 0x1819, 0x301d, 0xe801, 0xc005, 0xb809, 0x900d,
+  0xe03c, 0xc838, 0xb034, 0x9830, 0x402c, 0x6828, 0x1024, 0x3820,
+  0xd833, 0xf037, 0x883b, 0xa03f, 0x7823, 0x5027, 0x282b, 0x002f,
+  0x9022, 0xb826, 0xc02a, 0xe82e, 0x3032, 0x1836, 0x603a, 0x483e,
+  0xa82d, 0x8029, 0xf825, 0xd021, 0x083d, 0x2039, 0x5835, 0x7031,
+  0xb857, 0x9053, 0xe85f, 0xc05b, 0x1847, 0x3043, 0x484f, 0x604b,
+  0x8058, 0xa85c, 0xd050, 0xf854, 0x2048, 0x084c, 0x7040, 0x5844,
+  0xc849, 0xe04d, 0x9841, 0xb045, 0x6859, 0x405d, 0x3851, 0x1055,
+  0xf046, 0xd842, 0xa04e, 0x884a, 0x5056, 0x7852, 0x005e, 0x285a,
+  0x586b, 0x706f, 0x0863, 0x2067, 0xf87b, 0xd07f, 0xa873, 0x8077,
+  0x6064, 0x4860, 0x306c, 0x1868, 0xc074, 0xe870, 0x907c, 0xb878,
+  0x2875, 0x0071, 0x787d, 0x5079, 0x8865, 0xa061, 0xd86d, 0xf069,
+  0x107a, 0x387e, 0x4072, 0x6876, 0xb06a, 0x986e, 0xe062, 0xc866,
+  0x0881, 0x2085, 0x5889, 0x708d, 0xa891, 0x8095, 0xf899, 0xd09d,
+  0x308e, 0x188a, 0x6086, 0x4882, 0x909e, 0xb89a, 0xc096, 0xe892,
+  0x789f, 0x509b, 0x2897, 0x0093, 0xd88f, 0xf08b, 0x8887, 0xa083,
+  0x4090, 0x6894, 0x1098, 0x389c, 0xe080, 0xc884, 0xb088, 0x988c,
+  0xe8bd, 0xc0b9, 0xb8b5, 0x90b1, 0x48ad, 0x60a9, 0x18a5, 0x30a1,
+  0xd0b2, 0xf8b6, 0x80ba, 0xa8be, 0x70a2, 0x58a6, 0x20aa, 0x08ae,
+  0x98a3, 0xb0a7, 0xc8ab, 0xe0af, 0x38b3, 0x10b7, 0x68bb, 0x40bf,
+  0xa0ac, 0x88a8, 0xf0a4, 0xd8a0, 0x00bc, 0x28b8, 0x50b4, 0x78b0,
+  0xb0d6, 0x98d2, 0xe0de, 0xc8da, 0x10c6, 0x38c2, 0x40ce, 0x68ca,
+  0x88d9, 0xa0dd, 0xd8d1, 0xf0d5, 0x28c9, 0x00cd, 0x78c1, 0x50c5,
+  0xc0c8, 0xe8cc, 0x90c0, 0xb8c4, 0x60d8, 0x48dc, 0x30d0, 0x18d4,
+  0xf8c7, 0xd0c3, 0xa8cf, 0x80cb, 0x58d7, 0x70d3, 0x08df, 0x20db,
+  0x50ea, 0x78ee, 0x00e2, 0x28e6, 0xf0fa, 0xd8fe, 0xa0f2, 0x88f6,
+  0x68e5, 0x40e1, 0x38ed, 0x10e9, 0xc8f5, 0xe0f1, 0x98fd, 0xb0f9,
+  0x20f4, 0x08f0, 0x70fc, 0x58f8, 0x80e4, 0xa8e0, 0xd0ec, 0xf8e8,
+  0x18fb, 0x30ff, 0x48f3, 0x60f7, 0xb8eb, 0x90ef, 0xe8e3, 0xc0e7
+};
+
+/* Slicing-by-8 tables for CRC-16 CCITT, filled in by gst_dabplus_crc_init() */
+static guint16 gst_dabplus_ccitt_table[8][256];
+
+#ifdef DABPLUS_CRC_X86
+/* Split-nibble tables for the firecode: for every byte position 'k' of the
+   protected window, the contribution of the low/high nibble of that byte
+   to the low/high byte of the firecode.
+   Indexed as [k][nibble: 0 - low, 1 - high][firecode byte: 0 - low, 1 - high] */
+static guint8 gst_dabplus_firecode_nibble_table[FIRECODE_WINDOW][2][2][16]
+    __attribute__ ((aligned (16)));
+
+/* Folding constants for CRC-16 CCITT: x^128 mod P and x^192 mod P */
+static guint64 gst_dabplus_ccitt_fold_k128;
+static guint64 gst_dabplus_ccitt_fold_k192;
+#endif
+
+static inline guint16
+gst_dabplus_firecode_update (guint16 firecode, guint8 byte)
+{
+  /* XOR-in next input byte into MSB of 'firecode', that's our new intermediate divident */
+  guint8 pos = ((firecode >> 8) ^ byte);
+  /* Shift out the MSB used for division per lookuptable and XOR with the firecode */
+  return (guint16)((firecode << 8) ^ gst_dabplus_firecode_crc_table[pos]);
+}
+
+static inline guint16
+gst_dabplus_ccitt_update (guint16 crc, guint8 byte)
+{
+  return (guint16)((crc << 8) ^ gst_dabplus_ccitt_table[0][(crc >> 8) ^ byte]);
+}
+
+/**
+ * gst_dabplus_find_firecode_rolling:
+ *
+ * Portable implementation of gst_dabplus_crc_find_firecode().
+ * Instead of recomputing the firecode over FIRECODE_LENGTH - 2 bytes at every
+ * offset, a rolling firecode is maintained: at each step the incoming byte
+ * is divided in and the outgoing one is XOR-ed out.
+ */
+static gboolean
+gst_dabplus_find_firecode_rolling (const guint8 * data, guint from, guint to,
+    guint * offset)
+{
+  guint i;
+  guint16 firecode;
+
+  *offset = to;
+
+  if (from >= to)
+    return FALSE;
+
+  firecode = 0;
+  for (i = 2; i < FIRECODE_LENGTH; ++i)
+    firecode = gst_dabplus_firecode_update (firecode, data[from + i]);
+
+  for (i = from; ; ) {
+    /* all zeros will also generate zero firecode, hmmm */
+    if ((firecode != 0) && (firecode == ((data[i] << 8) | (data[i + 1] << 0)))) {
+      *offset = i;
+      return TRUE;
+    }
+
+    if (++i >= to)
+      break;
+
+    firecode = gst_dabplus_firecode_update (firecode,
+        data[i + FIRECODE_LENGTH - 1]) ^
+        gst_dabplus_firecode_rolling_table[data[i + 1]];
+  }
+
+  return FALSE;
+}
+
+/**
+ * gst_dabplus_crc_ccitt_slice8:
+ *
+ * Portable implementation of gst_dabplus_crc_ccitt() (slicing-by-8).
+ */
+static guint16
+gst_dabplus_crc_ccitt_slice8 (const guint8 * data, gsize size)
+{
+  guint16 crc = 0xffff;
+
+  while (size >= 8) {
+    crc = gst_dabplus_ccitt_table[7][(crc >> 8) ^ data[0]] ^
+          gst_dabplus_ccitt_table[6][(crc & 0xff) ^ data[1]] ^
+          gst_dabplus_ccitt_table[5][data[2]] ^
+          gst_dabplus_ccitt_table[4][data[3]] ^
+          gst_dabplus_ccitt_table[3][data[4]] ^
+          gst_dabplus_ccitt_table[2][data[5]] ^
+          gst_dabplus_ccitt_table[1][data[6]] ^
+          gst_dabplus_ccitt_table[0][data[7]];
+    data += 8;
+    size -= 8;
+  }
+
+  while (size--)
+    crc = gst_dabplus_ccitt_update (crc, *data++);
+
+  return crc ^ 0xffff;
+}
+
+#ifdef DABPLUS_CRC_X86
+
+/* Checks 16 consecutive candidate offsets at once. Bit 'n' of the result
+   is set if offset 'n' holds a valid (and non zero) firecode. */
+__attribute__ ((target ("ssse3")))
+static inline guint
+gst_dabplus_firecode_check16_ssse3 (const guint8 * data)
+{
+  const __m128i nibble_mask = _mm_set1_epi8 (0x0f);
+  __m128i lo = _mm_setzero_si128 ();
+  __m128i hi = _mm_setzero_si128 ();
+  __m128i hdr_hi, hdr_lo, valid;
+  guint k;
+
+  for (k = 0; k < FIRECODE_WINDOW; ++k) {
+    const __m128i v = _mm_loadu_si128 ((const __m128i *) (data + 2 + k));
+    const __m128i vl = _mm_and_si128 (v, nibble_mask);
+    const __m128i vh = _mm_and_si128 (_mm_srli_epi16 (v, 4), nibble_mask);
+    guint8 (*t)[2][16] = gst_dabplus_firecode_nibble_table[k];
+
+    lo = _mm_xor_si128 (lo, _mm_shuffle_epi8 (_mm_load_si128 ((const __m128i *) t[0][0]), vl));
+    lo = _mm_xor_si128 (lo, _mm_shuffle_epi8 (_mm_load_si128 ((const __m128i *) t[1][0]), vh));
+    hi = _mm_xor_si128 (hi, _mm_shuffle_epi8 (_mm_load_si128 ((const __m128i *) t[0][1]), vl));
+    hi = _mm_xor_si128 (hi, _mm_shuffle_epi8 (_mm_load_si128 ((const __m128i *) t[1][1]), vh));
+  }
+
+  hdr_hi = _mm_loadu_si128 ((const __m128i *) (data + 0));
+  hdr_lo = _mm_loadu_si128 ((const __m128i *) (data + 1));
+
+  valid = _mm_and_si128 (_mm_cmpeq_epi8 (hi, hdr_hi), _mm_cmpeq_epi8 (lo, hdr_lo));
+  /* all zeros will also generate zero firecode */
+  valid = _mm_andnot_si128 (
+      _mm_cmpeq_epi8 (_mm_or_si128 (hi, lo), _mm_setzero_si128 ()), valid);
+
+  return (guint) _mm_movemask_epi8 (valid);
+}
+
+__attribute__ ((target ("ssse3")))
+static gboolean
+gst_dabplus_find_firecode_ssse3 (const guint8 * data, guint from, guint to,
+    guint * offset)
+{
+  guint i;
+
+  for (i = from; i + 16 <= to; i += 16) {
+    guint mask = gst_dabplus_firecode_check16_ssse3 (data + i);
+    if (mask) {
+      *offset = i + __builtin_ctz (mask);
+      return TRUE;
+    }
+  }
+
+  return gst_dabplus_find_firecode_rolling (data, i, to, offset);
+}
+
+/* Checks 32 consecutive candidate offsets at once. Bit 'n' of the result
+   is set if offset 'n' holds a valid (and non zero) firecode. */
+__attribute__ ((target ("avx2")))
+static inline guint
+gst_dabplus_firecode_check32_avx2 (const guint8 * data)
+{
+  const __m256i nibble_mask = _mm256_set1_epi8 (0x0f);
+  __m256i lo = _mm256_setzero_si256 ();
+  __m256i hi = _mm256_setzero_si256 ();
+  __m256i hdr_hi, hdr_lo, valid;
+  guint k;
+
+  for (k = 0; k < FIRECODE_WINDOW; ++k) {
+    const __m256i v = _mm256_loadu_si256 ((const __m256i *) (data + 2 + k));
+    const __m256i vl = _mm256_and_si256 (v, nibble_mask);
+    const __m256i vh = _mm256_and_si256 (_mm256_srli_epi16 (v, 4), nibble_mask);
+    guint8 (*t)[2][16] = gst_dabplus_firecode_nibble_table[k];
+
+    lo = _mm256_xor_si256 (lo, _mm256_shuffle_epi8 (
+        _mm256_broadcastsi128_si256 (_mm_load_si128 ((const __m128i *) t[0][0])), vl));
+    lo = _mm256_xor_si256 (lo, _mm256_shuffle_epi8 (
+        _mm256_broadcastsi128_si256 (_mm_load_si128 ((const __m128i *) t[1][0])), vh));
+    hi = _mm256_xor_si256 (hi, _mm256_shuffle_epi8 (
+        _mm256_broadcastsi128_si256 (_mm_load_si128 ((const __m128i *) t[0][1])), vl));
+    hi = _mm256_xor_si256 (hi, _mm256_shuffle_epi8 (
+        _mm256_broadcastsi128_si256 (_mm_load_si128 ((const __m128i *) t[1][1])), vh));
+  }
+
+  hdr_hi = _mm256_loadu_si256 ((const __m256i *) (data + 0));
+  hdr_lo = _mm256_loadu_si256 ((const __m256i *) (data + 1));
+
+  valid = _mm256_and_si256 (_mm256_cmpeq_epi8 (hi, hdr_hi), _mm256_cmpeq_epi8 (lo, hdr_lo));
+  /* all zeros will also generate zero firecode */
+  valid = _mm256_andnot_si256 (
+      _mm256_cmpeq_epi8 (_mm256_or_si256 (hi, lo), _mm256_setzero_si256 ()), valid);
+
+  return (guint) _mm256_movemask_epi8 (valid);
+}
+
+__attribute__ ((target ("avx2")))
+static gboolean
+gst_dabplus_find_firecode_avx2 (const guint8 * data, guint from, guint to,
+    guint * offset)
+{
+  guint i;
+
+  for (i = from; i + 32 <= to; i += 32) {
+    guint mask = gst_dabplus_firecode_check32_avx2 (data + i);
+    if (mask) {
+      *offset = i + __builtin_ctz (mask);
+      return TRUE;
+    }
+  }
+
+  return gst_dabplus_find_firecode_rolling (data, i, to, offset);
+}
+
+/**
+ * gst_dabplus_crc_ccitt_pclmul:
+ *
+ * PCLMULQDQ implementation of gst_dabplus_crc_ccitt().
+ * The message is folded 16 bytes at a time into a 128 bit remainder
+ * which is congruent to it modulo the CCITT polynomial. The remainder
+ * and the tail of the message are then reduced by the portable code.
+ */
+__attribute__ ((target ("pclmul,ssse3")))
+static guint16
+gst_dabplus_crc_ccitt_pclmul (const guint8 * data, gsize size)
+{
+  const __m128i bswap = _mm_set_epi8 (0, 1, 2, 3, 4, 5, 6, 7,
+                                      8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i k = _mm_set_epi64x (gst_dabplus_ccitt_fold_k192,
+                                    gst_dabplus_ccitt_fold_k128);
+  guint8 folded[16];
+  __m128i acc;
+  guint16 crc;
+
+  if (size < 32)
+    return gst_dabplus_crc_ccitt_slice8 (data, size);
+
+  /* Initial value of 0xffff is the same as inverting the first 16 bits
+     of the message and starting from zero */
+  acc = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) data), bswap);
+  acc = _mm_xor_si128 (acc, _mm_set_epi64x (0xffff000000000000ULL, 0));
+  data += 16;
+  size -= 16;
+
+  while (size >= 16) {
+    const __m128i next =
+        _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) data), bswap);
+    /* acc * x^128 = acc.hi * x^192 + acc.lo * x^128 */
+    acc = _mm_xor_si128 (
+        _mm_xor_si128 (_mm_clmulepi64_si128 (acc, k, 0x11),
+                       _mm_clmulepi64_si128 (acc, k, 0x00)),
+        next);
+    data += 16;
+    size -= 16;
+  }
+
+  _mm_storeu_si128 ((__m128i *) folded, _mm_shuffle_epi8 (acc, bswap));
+
+  crc = 0;
+  for (guint i = 0; i < sizeof (folded); ++i)
+    crc = gst_dabplus_ccitt_update (crc, folded[i]);
+  while (size--)
+    crc = gst_dabplus_ccitt_update (crc, *data++);
+
+  return crc ^ 0xffff;
+}
+
+static guint64
+gst_dabplus_ccitt_xpow_mod (guint n)
+{
+  guint32 r = 1;
+
+  /* x^n mod P, bit by bit */
+  while (n--) {
+    r <<= 1;
+    if (r & 0x10000)
+      r ^= 0x10000 | CCITT_POLYNOMIAL;
+  }
+
+  return r;
+}
+
+#endif /* DABPLUS_CRC_X86 */
+
+static GstDabPlusCrcKernels gst_dabplus_crc_kernels = {
+  "rolling", gst_dabplus_find_firecode_rolling,
+  "slice8", gst_dabplus_crc_ccitt_slice8
+};
+
+static void
+gst_dabplus_crc_init_tables (void)
+{
+  guint i, j;
+
+  for (i = 0; i < 256; ++i) {
+    guint16 crc = i << 8;
+    for (j = 0; j < 8; ++j)
+      crc = (crc & 0x8000) ? ((crc << 1) ^ CCITT_POLYNOMIAL) : (crc << 1);
+    gst_dabplus_ccitt_table[0][i] = crc;
+  }
+
+  for (i = 0; i < 256; ++i)
+    for (j = 1; j < 8; ++j)
+      gst_dabplus_ccitt_table[j][i] =
+          gst_dabplus_ccitt_update (gst_dabplus_ccitt_table[j - 1][i], 0);
+
+#ifdef DABPLUS_CRC_X86
+  for (i = 0; i < FIRECODE_WINDOW; ++i) {
+    for (j = 0; j < 16; ++j) {
+      guint16 lo = gst_dabplus_firecode_crc_table[j];
+      guint16 hi = gst_dabplus_firecode_crc_table[j << 4];
+      guint n;
+
+      /* byte 'i' of the window is followed by FIRECODE_WINDOW - 1 - i bytes */
+      for (n = i + 1; n < FIRECODE_WINDOW; ++n) {
+        lo = gst_dabplus_firecode_update (lo, 0);
+        hi = gst_dabplus_firecode_update (hi, 0);
+      }
+
+      gst_dabplus_firecode_nibble_table[i][0][0][j] = lo & 0xff;
+      gst_dabplus_firecode_nibble_table[i][0][1][j] = lo >> 8;
+      gst_dabplus_firecode_nibble_table[i][1][0][j] = hi & 0xff;
+      gst_dabplus_firecode_nibble_table[i][1][1][j] = hi >> 8;
+    }
+  }
+
+  gst_dabplus_ccitt_fold_k128 = gst_dabplus_ccitt_xpow_mod (128);
+  gst_dabplus_ccitt_fold_k192 = gst_dabplus_ccitt_xpow_mod (192);
+#endif
+}
+
+/**
+ * gst_dabplus_crc_init:
+ *
+ * Initializes lookup tables and selects the best firecode and CRC kernels
+ * supported by the CPU we are running on. Has to be called (once is enough)
+ * before any other gst_dabplus_crc_* function is used.
+ *
+ * Returns: None.
+ */
+void
+gst_dabplus_crc_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    gst_dabplus_crc_init_tables ();
+
+#ifdef DABPLUS_CRC_X86
+    __builtin_cpu_init ();
+
+    if (__builtin_cpu_supports ("avx2")) {
+      gst_dabplus_crc_kernels.find_firecode_name = "avx2";
+      gst_dabplus_crc_kernels.find_firecode = gst_dabplus_find_firecode_avx2;
+    } else if (__builtin_cpu_supports ("ssse3")) {
+      gst_dabplus_crc_kernels.find_firecode_name = "ssse3";
+      gst_dabplus_crc_kernels.find_firecode = gst_dabplus_find_firecode_ssse3;
+    }
+
+    if (__builtin_cpu_supports ("pclmul") && __builtin_cpu_supports ("ssse3")) {
+      gst_dabplus_crc_kernels.crc_ccitt_name = "pclmul";
+      gst_dabplus_crc_kernels.crc_ccitt = gst_dabplus_crc_ccitt_pclmul;
+    }
+#endif
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/**
+ * gst_dabplus_crc_get_kernel_names:
+ * @find_firecode: Set to the name of the firecode search kernel.
+ * @crc_ccitt: Set to the name of the CRC-16 CCITT kernel.
+ *
+ * Tells which kernels were selected by gst_dabplus_crc_init().
+ *
+ * Returns: None.
+ */
+void
+gst_dabplus_crc_get_kernel_names (const gchar ** find_firecode,
+    const gchar ** crc_ccitt)
+{
+  *find_firecode = gst_dabplus_crc_kernels.find_firecode_name;
+  *crc_ccitt = gst_dabplus_crc_kernels.crc_ccitt_name;
+}
+
+/**
+ * gst_dabplus_crc_check_firecode:
+ * @data: Superframe header candidate,
+ *        caller ensures at least FIRECODE_LENGTH bytes of data.
+ *
+ * Returns: TRUE if @data starts with a valid firecode.
+ */
+gboolean
+gst_dabplus_crc_check_firecode (const guint8 * data)
+{
+  gboolean retval = FALSE;
+
+  do {
+    guint16 firecode;
+    guint16 header_firecode;
+
+    firecode = 0;
+    header_firecode = (data[0] << 8) | (data[1] << 0);
+
+    for (gint i = 2; i < FIRECODE_LENGTH; ++i)
+      firecode = gst_dabplus_firecode_update (firecode, data[i]);
+
+    if (header_firecode != firecode)
+      break;
+
+    /* all zeros will also generate zero firecode, hmmm */
+    if (firecode == 0)
+      break;
+
+    retval = TRUE;
+  } while (0);
+
+  return retval;
+}
+
+/**
+ * gst_dabplus_crc_find_firecode:
+ * @data: A block of data to be searched.
+ * @from: First offset to be checked.
+ * @to: Offset at which the search stops (exclusive).
+ * @offset: Set to the offset of the first valid firecode,
+ *          or to @to if there is none.
+ *
+ * Searches for the first offset within [@from, @to) holding a valid firecode.
+ * Caller ensures that @data holds at least @to + FIRECODE_LENGTH - 1 bytes.
+ *
+ * Returns: TRUE if valid firecode was found.
+ */
+gboolean
+gst_dabplus_crc_find_firecode (const guint8 * data, guint from, guint to,
+    guint * offset)
+{
+  return gst_dabplus_crc_kernels.find_firecode (data, from, to, offset);
+}
+
+/**
+ * gst_dabplus_crc_ccitt:
+ * @data: Data to be protected.
+ * @size: Size of @data.
+ *
+ * Calculates CRC-16 CCITT as used to protect DAB+ access units
+ * (initial value 0xffff, result inverted).
+ *
+ * Returns: The CRC.
+ */
+guint16
+gst_dabplus_crc_ccitt (const guint8 * data, gsize size)
+{
+  return gst_dabplus_crc_kernels.crc_ccitt (data, size);
+}
@@ -0,0 +1,44 @@
+/* GStreamer DAB Plus firecode and CRC kernels
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DABPLUSCRC_H__
+#define __GST_DABPLUSCRC_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define FIRECODE_LENGTH        11   /* 2 bytes of firecode + 9 bytes protected by it */
+
+void gst_dabplus_crc_init (void);
+
+void gst_dabplus_crc_get_kernel_names (const gchar ** find_firecode,
+    const gchar ** crc_ccitt);
+
+gboolean gst_dabplus_crc_check_firecode (const guint8 * data);
+
+gboolean gst_dabplus_crc_find_firecode (const guint8 * data,
+    guint from, guint to, guint * offset);
+
+guint16 gst_dabplus_crc_ccitt (const guint8 * data, gsize size);
+
+G_END_DECLS
+
+#endif /* __GST_DABPLUSCRC_H__ */
@@ -0,0 +1,564 @@
+/* GStreamer DAB Plus superframe index
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Sidecar index of a recorded DAB+ subchannel. It lists every superframe
+ * found by the parser, so that recordings with gaps or resynchronisations
+ * (where offsets are no longer a multiple of the superframe size)
+ * can be seeked without scanning them again.
+ *
+ * The file starts with a header (all fields little endian):
+ *
+ *   magic "DABX" (4), version (1), flags (1), reserved (2),
+ *   superframe size (4), number of entries (4), recording size (8)
+ *
+ * followed by one record per superframe. Records are coded against what is
+ * expected after the previous superframe (superframe_size bytes and 120 ms
+ * further), so a continuous recording costs 3 bytes per superframe:
+ *
+ *   zigzag varint: offset - (previous offset + superframe size)
+ *   zigzag varint: pts - (previous pts + 120 ms)
+ *   byte: GST_DABPLUS_INDEX_FLAG_*
+ *
+ * The header is written with the complete flag cleared and patched once the
+ * whole recording is indexed, so interrupted indexes are never used.
+ * The size of the recording is stored along, so that an index left next to
+ * a recording it does not belong to can be told apart.
+ * Readers map the file and keep one decoded entry every
+ * INDEX_CHECKPOINT_INTERVAL records, lookups decode forward from there.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "gstdabplusindex.h"
+
+#define INDEX_MAGIC                 "DABX"
+#define INDEX_VERSION               2
+#define INDEX_FLAG_COMPLETE         (1 << 0)
+#define INDEX_HEADER_LENGTH         24
+#define INDEX_MAX_RECORD_LENGTH     (10 + 10 + 1) /* two 64 bit varints and flags */
+#define INDEX_CHECKPOINT_INTERVAL   64
+
+typedef struct {
+  GstDabPlusIndexEntry entry;
+  gsize pos; /* position of the record following 'entry' */
+} GstDabPlusIndexCheckpoint;
+
+struct _GstDabPlusIndex {
+  gint ref_count;
+
+  GMappedFile *file;
+  const guint8 *data;
+  gsize size;
+
+  guint superframe_size;
+  guint n_entries;
+  guint64 recording_size;
+
+  /* entry 'k * INDEX_CHECKPOINT_INTERVAL' for every 'k' */
+  GArray *checkpoints;
+};
+
+struct _GstDabPlusIndexWriter {
+  FILE *file;
+  gchar *location;
+
+  guint superframe_size;
+  guint n_entries;
+  GstDabPlusIndexEntry last;
+};
+
+/* Entry preceding the first one, so that the first record is coded
+   like any other (the arithmetic is modulo 2^64) */
+static void
+gst_dabplus_index_entry_init (GstDabPlusIndexEntry * entry,
+    guint superframe_size)
+{
+  entry->offset = -(guint64) superframe_size;
+  entry->pts = -GST_DABPLUS_INDEX_SUPERFRAME_DURATION;
+  entry->flags = 0;
+}
+
+static guint
+gst_dabplus_index_write_varint (guint8 * data, gint64 value)
+{
+  guint64 v = ((guint64) value << 1) ^ (guint64) (value >> 63);
+  guint n = 0;
+
+  while (v >= 0x80) {
+    data[n++] = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+  data[n++] = v;
+
+  return n;
+}
+
+static gboolean
+gst_dabplus_index_read_varint (const guint8 * data, gsize size, gsize * pos,
+    gint64 * value)
+{
+  guint64 v = 0;
+  guint shift;
+
+  for (shift = 0; (shift < 64) && (*pos < size); shift += 7) {
+    guint8 byte = data[(*pos)++];
+
+    v |= (guint64) (byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *value = (gint64) (v >> 1) ^ -(gint64) (v & 1);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/* Decodes the record at '*pos', 'entry' holds the previous entry on input */
+static gboolean
+gst_dabplus_index_read_entry (const GstDabPlusIndex * index, gsize * pos,
+    GstDabPlusIndexEntry * entry)
+{
+  gint64 d_offset, d_pts;
+
+  if (!gst_dabplus_index_read_varint (index->data, index->size, pos, &d_offset) ||
+      !gst_dabplus_index_read_varint (index->data, index->size, pos, &d_pts) ||
+      (*pos >= index->size))
+    return FALSE;
+
+  entry->offset += index->superframe_size + d_offset;
+  entry->pts += GST_DABPLUS_INDEX_SUPERFRAME_DURATION + d_pts;
+  entry->flags = index->data[(*pos)++];
+
+  return TRUE;
+}
+
+static void
+gst_dabplus_index_write_header (guint8 * header, guint superframe_size,
+    guint n_entries, guint64 recording_size, gboolean complete)
+{
+  guint32 v;
+  guint64 v64;
+
+  memcpy (header, INDEX_MAGIC, 4);
+  header[4] = INDEX_VERSION;
+  header[5] = complete ? INDEX_FLAG_COMPLETE : 0;
+  header[6] = header[7] = 0;
+  v = GUINT32_TO_LE (superframe_size);
+  memcpy (header + 8, &v, 4);
+  v = GUINT32_TO_LE (n_entries);
+  memcpy (header + 12, &v, 4);
+  v64 = GUINT64_TO_LE (recording_size);
+  memcpy (header + 16, &v64, 8);
+}
+
+/**
+ * gst_dabplus_index_open:
+ * @location: Path of the index file.
+ *
+ * Maps the index and decodes it once, keeping every
+ * INDEX_CHECKPOINT_INTERVAL-th entry.
+ *
+ * Returns: Newly allocated #GstDabPlusIndex, to be released with
+ *          gst_dabplus_index_unref(), or NULL if the file does not
+ *          exist or does not hold a complete, valid index.
+ */
+GstDabPlusIndex *
+gst_dabplus_index_open (const gchar * location)
+{
+  GstDabPlusIndex *index;
+  GstDabPlusIndexCheckpoint checkpoint;
+  guint32 v;
+  guint64 v64;
+  gsize pos;
+  guint i;
+
+  g_return_val_if_fail (location != NULL, NULL);
+
+  index = g_new0 (GstDabPlusIndex, 1);
+  index->ref_count = 1;
+  index->file = g_mapped_file_new (location, FALSE, NULL);
+  if (!index->file)
+    goto fail;
+
+  index->data = (const guint8 *) g_mapped_file_get_contents (index->file);
+  index->size = g_mapped_file_get_length (index->file);
+
+  if ((index->size < INDEX_HEADER_LENGTH) ||
+      memcmp (index->data, INDEX_MAGIC, 4) ||
+      (index->data[4] != INDEX_VERSION) ||
+      !(index->data[5] & INDEX_FLAG_COMPLETE))
+    goto fail;
+
+  memcpy (&v, index->data + 8, 4);
+  index->superframe_size = GUINT32_FROM_LE (v);
+  memcpy (&v, index->data + 12, 4);
+  index->n_entries = GUINT32_FROM_LE (v);
+  memcpy (&v64, index->data + 16, 8);
+  index->recording_size = GUINT64_FROM_LE (v64);
+
+  if (index->superframe_size == 0)
+    goto fail;
+
+  index->checkpoints = g_array_sized_new (FALSE, FALSE,
+    sizeof (GstDabPlusIndexCheckpoint),
+    index->n_entries / INDEX_CHECKPOINT_INTERVAL + 1);
+
+  gst_dabplus_index_entry_init (&checkpoint.entry, index->superframe_size);
+  pos = INDEX_HEADER_LENGTH;
+
+  for (i = 0; i < index->n_entries; ++i) {
+    if (!gst_dabplus_index_read_entry (index, &pos, &checkpoint.entry))
+      goto fail;
+
+    if ((i % INDEX_CHECKPOINT_INTERVAL) == 0) {
+      checkpoint.pos = pos;
+      g_array_append_val (index->checkpoints, checkpoint);
+    }
+  }
+
+  if (pos != index->size)
+    goto fail;
+
+  return index;
+
+fail:
+  gst_dabplus_index_unref (index);
+  return NULL;
+}
+
+/**
+ * gst_dabplus_index_ref:
+ * @index: #GstDabPlusIndex.
+ *
+ * Takes a reference, so that the index can be used while
+ * another thread releases it.
+ *
+ * Returns: @index.
+ */
+GstDabPlusIndex *
+gst_dabplus_index_ref (GstDabPlusIndex * index)
+{
+  g_atomic_int_inc (&index->ref_count);
+
+  return index;
+}
+
+/**
+ * gst_dabplus_index_unref:
+ * @index: #GstDabPlusIndex.
+ *
+ * Releases a reference, unmapping and freeing the index with the last one.
+ *
+ * Returns: None.
+ */
+void
+gst_dabplus_index_unref (GstDabPlusIndex * index)
+{
+  if (!g_atomic_int_dec_and_test (&index->ref_count))
+    return;
+
+  if (index->checkpoints)
+    g_array_free (index->checkpoints, TRUE);
+  if (index->file)
+    g_mapped_file_unref (index->file);
+  g_free (index);
+}
+
+/**
+ * gst_dabplus_index_get_superframe_size:
+ * @index: #GstDabPlusIndex.
+ *
+ * Returns: Size of the superframes of the indexed recording.
+ */
+guint
+gst_dabplus_index_get_superframe_size (const GstDabPlusIndex * index)
+{
+  return index->superframe_size;
+}
+
+/**
+ * gst_dabplus_index_get_recording_size:
+ * @index: #GstDabPlusIndex.
+ *
+ * Returns: Size in bytes of the recording the index was built from.
+ */
+guint64
+gst_dabplus_index_get_recording_size (const GstDabPlusIndex * index)
+{
+  return index->recording_size;
+}
+
+/**
+ * gst_dabplus_index_get_n_entries:
+ * @index: #GstDabPlusIndex.
+ *
+ * Returns: Number of indexed superframes.
+ */
+guint
+gst_dabplus_index_get_n_entries (const GstDabPlusIndex * index)
+{
+  return index->n_entries;
+}
+
+/**
+ * gst_dabplus_index_get_entry:
+ * @index: #GstDabPlusIndex.
+ * @n: Number of the entry.
+ * @entry: Set to entry @n.
+ *
+ * Returns: TRUE if @n is lower than the number of entries.
+ */
+gboolean
+gst_dabplus_index_get_entry (const GstDabPlusIndex * index, guint n,
+    GstDabPlusIndexEntry * entry)
+{
+  const GstDabPlusIndexCheckpoint *checkpoint;
+  gsize pos;
+  guint i;
+
+  if (n >= index->n_entries)
+    return FALSE;
+
+  checkpoint = &g_array_index (index->checkpoints, GstDabPlusIndexCheckpoint,
+    n / INDEX_CHECKPOINT_INTERVAL);
+  *entry = checkpoint->entry;
+  pos = checkpoint->pos;
+
+  /* the index was validated when opened */
+  for (i = 0; i < n % INDEX_CHECKPOINT_INTERVAL; ++i)
+    gst_dabplus_index_read_entry (index, &pos, entry);
+
+  return TRUE;
+}
+
+/* Finds the last entry for which 'key' (offset or pts) is not greater
+   than 'value', or the first entry if there is no such */
+static gboolean
+gst_dabplus_index_find (const GstDabPlusIndex * index, gsize key,
+    guint64 value, GstDabPlusIndexEntry * entry)
+{
+  const GstDabPlusIndexCheckpoint *checkpoint;
+  GstDabPlusIndexEntry next;
+  guint lo, hi, n;
+  gsize pos;
+
+#define INDEX_KEY(e) (*(const guint64 *) ((const guint8 *) (e) + key))
+
+  if (index->n_entries == 0)
+    return FALSE;
+
+  /* last checkpoint not past 'value' */
+  lo = 0;
+  hi = index->checkpoints->len;
+  while (hi - lo > 1) {
+    guint mid = lo + (hi - lo) / 2;
+
+    checkpoint = &g_array_index (index->checkpoints,
+      GstDabPlusIndexCheckpoint, mid);
+    if (INDEX_KEY (&checkpoint->entry) <= value)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  checkpoint = &g_array_index (index->checkpoints, GstDabPlusIndexCheckpoint, lo);
+  *entry = checkpoint->entry;
+  pos = checkpoint->pos;
+
+  for (n = lo * INDEX_CHECKPOINT_INTERVAL + 1; n < index->n_entries; ++n) {
+    next = *entry;
+    gst_dabplus_index_read_entry (index, &pos, &next);
+    if (INDEX_KEY (&next) > value)
+      break;
+    *entry = next;
+  }
+
+#undef INDEX_KEY
+
+  return TRUE;
+}
+
+/**
+ * gst_dabplus_index_find_by_time:
+ * @index: #GstDabPlusIndex.
+ * @pts: Timestamp in nanoseconds.
+ * @entry: Set to the superframe @pts falls in.
+ *
+ * Returns: FALSE if the index is empty.
+ */
+gboolean
+gst_dabplus_index_find_by_time (const GstDabPlusIndex * index, guint64 pts,
+    GstDabPlusIndexEntry * entry)
+{
+  return gst_dabplus_index_find (index,
+    G_STRUCT_OFFSET (GstDabPlusIndexEntry, pts), pts, entry);
+}
+
+/**
+ * gst_dabplus_index_find_by_offset:
+ * @index: #GstDabPlusIndex.
+ * @offset: Byte offset in the recording.
+ * @entry: Set to the last superframe starting at or before @offset.
+ *
+ * Returns: FALSE if the index is empty.
+ */
+gboolean
+gst_dabplus_index_find_by_offset (const GstDabPlusIndex * index,
+    guint64 offset, GstDabPlusIndexEntry * entry)
+{
+  return gst_dabplus_index_find (index,
+    G_STRUCT_OFFSET (GstDabPlusIndexEntry, offset), offset, entry);
+}
+
+/**
+ * gst_dabplus_index_writer_new:
+ * @location: Path of the index file, overwritten if it exists.
+ * @superframe_size: Size of the superframes of the recording.
+ *
+ * Returns: Newly allocated #GstDabPlusIndexWriter or NULL
+ *          if the file cannot be created.
+ */
+GstDabPlusIndexWriter *
+gst_dabplus_index_writer_new (const gchar * location, guint superframe_size)
+{
+  GstDabPlusIndexWriter *writer;
+  guint8 header[INDEX_HEADER_LENGTH];
+  FILE *file;
+
+  g_return_val_if_fail (location != NULL, NULL);
+  g_return_val_if_fail (superframe_size > 0, NULL);
+
+  file = g_fopen (location, "wb");
+  if (!file)
+    return NULL;
+
+  gst_dabplus_index_write_header (header, superframe_size, 0, 0, FALSE);
+  if (fwrite (header, sizeof (header), 1, file) != 1) {
+    fclose (file);
+    g_unlink (location);
+    return NULL;
+  }
+
+  writer = g_new0 (GstDabPlusIndexWriter, 1);
+  writer->file = file;
+  writer->location = g_strdup (location);
+  writer->superframe_size = superframe_size;
+  writer->n_entries = 0;
+  gst_dabplus_index_entry_init (&writer->last, superframe_size);
+
+  return writer;
+}
+
+/**
+ * gst_dabplus_index_writer_add:
+ * @writer: #GstDabPlusIndexWriter.
+ * @entry: Next superframe of the recording.
+ *
+ * Superframes have to be added in the order of their offsets.
+ *
+ * Returns: FALSE if @entry is out of order or it cannot be written.
+ */
+gboolean
+gst_dabplus_index_writer_add (GstDabPlusIndexWriter * writer,
+    const GstDabPlusIndexEntry * entry)
+{
+  guint8 record[INDEX_MAX_RECORD_LENGTH];
+  guint n;
+
+  if ((writer->n_entries > 0) && (entry->offset <= writer->last.offset))
+    return FALSE;
+
+  if (writer->n_entries == G_MAXUINT32)
+    return FALSE;
+
+  n = gst_dabplus_index_write_varint (record,
+    (gint64) (entry->offset - writer->last.offset - writer->superframe_size));
+  n += gst_dabplus_index_write_varint (record + n,
+    (gint64) (entry->pts - writer->last.pts - GST_DABPLUS_INDEX_SUPERFRAME_DURATION));
+  record[n++] = entry->flags;
+
+  if (fwrite (record, n, 1, writer->file) != 1)
+    return FALSE;
+
+  writer->last = *entry;
+  writer->n_entries++;
+
+  return TRUE;
+}
+
+/**
+ * gst_dabplus_index_writer_finish:
+ * @writer: #GstDabPlusIndexWriter.
+ * @recording_size: Size in bytes of the indexed recording.
+ *
+ * Marks the index as complete and frees @writer.
+ * If that fails, the file is removed.
+ *
+ * Returns: TRUE if the index was successfully written.
+ */
+gboolean
+gst_dabplus_index_writer_finish (GstDabPlusIndexWriter * writer,
+    guint64 recording_size)
+{
+  guint8 header[INDEX_HEADER_LENGTH];
+  gboolean status;
+
+  gst_dabplus_index_write_header (header, writer->superframe_size,
+    writer->n_entries, recording_size, TRUE);
+
+  status = (fseek (writer->file, 0, SEEK_SET) == 0) &&
+    (fwrite (header, sizeof (header), 1, writer->file) == 1);
+  status = (fclose (writer->file) == 0) && status;
+  writer->file = NULL;
+
+  if (!status)
+    g_unlink (writer->location);
+
+  g_free (writer->location);
+  g_free (writer);
+
+  return status;
+}
+
+/**
+ * gst_dabplus_index_writer_abort:
+ * @writer: #GstDabPlusIndexWriter.
+ *
+ * Removes the (incomplete) index and frees @writer.
+ *
+ * Returns: None.
+ */
+void
+gst_dabplus_index_writer_abort (GstDabPlusIndexWriter * writer)
+{
+  fclose (writer->file);
+  g_unlink (writer->location);
+
+  g_free (writer->location);
+  g_free (writer);
+}
@@ -0,0 +1,85 @@
+/* GStreamer DAB Plus superframe index
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DABPLUSINDEX_H__
+#define __GST_DABPLUSINDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define GST_DABPLUS_INDEX_SUPERFRAME_DURATION G_GUINT64_CONSTANT (120000000) /* ns */
+
+/* Error state of an indexed superframe */
+#define GST_DABPLUS_INDEX_FLAG_RS_CORRECTED   (1 << 0) /* Reed-Solomon corrected errors */
+#define GST_DABPLUS_INDEX_FLAG_AU_CRC_ERRORS  (1 << 1) /* some access units failed CRC */
+
+typedef struct _GstDabPlusIndex       GstDabPlusIndex;
+typedef struct _GstDabPlusIndexWriter GstDabPlusIndexWriter;
+
+/**
+ * GstDabPlusIndexEntry:
+ * @offset: Byte offset of the superframe in the recording.
+ * @pts: Timestamp of the superframe in nanoseconds.
+ * @flags: GST_DABPLUS_INDEX_FLAG_* describing the superframe error state.
+ *
+ * One superframe of an index.
+ */
+typedef struct {
+  guint64 offset;
+  guint64 pts;
+  guint flags;
+} GstDabPlusIndexEntry;
+
+GstDabPlusIndex *gst_dabplus_index_open (const gchar * location);
+
+GstDabPlusIndex *gst_dabplus_index_ref (GstDabPlusIndex * index);
+
+void gst_dabplus_index_unref (GstDabPlusIndex * index);
+
+guint gst_dabplus_index_get_superframe_size (const GstDabPlusIndex * index);
+
+guint64 gst_dabplus_index_get_recording_size (const GstDabPlusIndex * index);
+
+guint gst_dabplus_index_get_n_entries (const GstDabPlusIndex * index);
+
+gboolean gst_dabplus_index_get_entry (const GstDabPlusIndex * index,
+    guint n, GstDabPlusIndexEntry * entry);
+
+gboolean gst_dabplus_index_find_by_time (const GstDabPlusIndex * index,
+    guint64 pts, GstDabPlusIndexEntry * entry);
+
+gboolean gst_dabplus_index_find_by_offset (const GstDabPlusIndex * index,
+    guint64 offset, GstDabPlusIndexEntry * entry);
+
+GstDabPlusIndexWriter *gst_dabplus_index_writer_new (const gchar * location,
+    guint superframe_size);
+
+gboolean gst_dabplus_index_writer_add (GstDabPlusIndexWriter * writer,
+    const GstDabPlusIndexEntry * entry);
+
+gboolean gst_dabplus_index_writer_finish (GstDabPlusIndexWriter * writer,
+    guint64 recording_size);
+
+void gst_dabplus_index_writer_abort (GstDabPlusIndexWriter * writer);
+
+G_END_DECLS
+
+#endif /* __GST_DABPLUSINDEX_H__ */
@@ -0,0 +1,329 @@
+/* GStreamer DAB Plus buffer metadata
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstdabplusmeta.h"
+
+/**
+ * gst_dabplus_erasure_meta_api_get_type:
+ *
+ * Returns: #GType of the #GstDabPlusErasureMeta API.
+ */
+GType
+gst_dabplus_erasure_meta_api_get_type (void)
+{
+  static gsize type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstDabPlusErasureMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+
+  return type;
+}
+
+static gboolean
+gst_dabplus_erasure_meta_init (GstMeta * meta, gpointer params,
+    GstBuffer * buffer)
+{
+  GstDabPlusErasureMeta *emeta = (GstDabPlusErasureMeta *) meta;
+
+  emeta->offset = 0;
+  emeta->size = 0;
+  emeta->reliability = NULL;
+
+  return TRUE;
+}
+
+static void
+gst_dabplus_erasure_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstDabPlusErasureMeta *emeta = (GstDabPlusErasureMeta *) meta;
+
+  g_free (emeta->reliability);
+  emeta->reliability = NULL;
+}
+
+static gboolean
+gst_dabplus_erasure_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstDabPlusErasureMeta *emeta = (GstDabPlusErasureMeta *) meta;
+
+  /* positions are absolute, so copies (also of regions) keep the whole
+     description and the parser picks the part it needs */
+  if (GST_META_TRANSFORM_IS_COPY (type))
+    return gst_buffer_add_dabplus_erasure_meta (dest,
+      emeta->offset, emeta->reliability, emeta->size) != NULL;
+
+  /* transform type not supported */
+  return FALSE;
+}
+
+/**
+ * gst_dabplus_erasure_meta_get_info:
+ *
+ * Returns: #GstMetaInfo of #GstDabPlusErasureMeta.
+ */
+const GstMetaInfo *
+gst_dabplus_erasure_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & meta_info)) {
+    const GstMetaInfo *mi = gst_meta_register (GST_DABPLUS_ERASURE_META_API_TYPE,
+        "GstDabPlusErasureMeta", sizeof (GstDabPlusErasureMeta),
+        gst_dabplus_erasure_meta_init,
+        gst_dabplus_erasure_meta_free,
+        gst_dabplus_erasure_meta_transform);
+    g_once_init_leave ((GstMetaInfo **) & meta_info, (GstMetaInfo *) mi);
+  }
+
+  return meta_info;
+}
+
+/**
+ * gst_buffer_add_dabplus_erasure_meta:
+ * @buffer: A #GstBuffer.
+ * @offset: Position of the first described byte in the byte stream.
+ * @reliability: Reliability of @size bytes (0 - erased, 255 - fully reliable).
+ * @size: Number of described bytes.
+ *
+ * Attaches per-byte reliability hints to @buffer. @reliability is copied.
+ *
+ * Returns: The #GstDabPlusErasureMeta added to @buffer.
+ */
+GstDabPlusErasureMeta *
+gst_buffer_add_dabplus_erasure_meta (GstBuffer * buffer, guint64 offset,
+    const guint8 * reliability, gsize size)
+{
+  GstDabPlusErasureMeta *emeta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (reliability != NULL || size == 0, NULL);
+
+  emeta = (GstDabPlusErasureMeta *) gst_buffer_add_meta (buffer,
+      GST_DABPLUS_ERASURE_META_INFO, NULL);
+  if (!emeta)
+    return NULL;
+
+  emeta->offset = offset;
+  emeta->size = size;
+  emeta->reliability = g_malloc (size);
+  memcpy (emeta->reliability, reliability, size);
+
+  return emeta;
+}
+
+/**
+ * gst_dabplus_superframe_meta_api_get_type:
+ *
+ * Returns: #GType of the #GstDabPlusSuperframeMeta API.
+ */
+GType
+gst_dabplus_superframe_meta_api_get_type (void)
+{
+  static gsize type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstDabPlusSuperframeMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+
+  return type;
+}
+
+static gboolean
+gst_dabplus_superframe_meta_init (GstMeta * meta, gpointer params,
+    GstBuffer * buffer)
+{
+  GstDabPlusSuperframeMeta *smeta = (GstDabPlusSuperframeMeta *) meta;
+
+  memset ((guint8 *) smeta + sizeof (GstMeta), 0,
+    sizeof (GstDabPlusSuperframeMeta) - sizeof (GstMeta));
+
+  return TRUE;
+}
+
+static gboolean
+gst_dabplus_superframe_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstDabPlusSuperframeMeta *smeta = (GstDabPlusSuperframeMeta *) meta;
+  GstDabPlusSuperframeMeta *dmeta;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    GstMetaTransformCopy *copy = data;
+
+    /* positions are relative to the buffer, only whole copies keep them valid */
+    if (copy->region)
+      return TRUE;
+
+    dmeta = gst_buffer_add_dabplus_superframe_meta (dest);
+    if (!dmeta)
+      return FALSE;
+
+    memcpy ((guint8 *) dmeta + sizeof (GstMeta),
+      (const guint8 *) smeta + sizeof (GstMeta),
+      sizeof (GstDabPlusSuperframeMeta) - sizeof (GstMeta));
+    return TRUE;
+  }
+
+  /* transform type not supported */
+  return FALSE;
+}
+
+/**
+ * gst_dabplus_superframe_meta_get_info:
+ *
+ * Returns: #GstMetaInfo of #GstDabPlusSuperframeMeta.
+ */
+const GstMetaInfo *
+gst_dabplus_superframe_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & meta_info)) {
+    const GstMetaInfo *mi = gst_meta_register (GST_DABPLUS_SUPERFRAME_META_API_TYPE,
+        "GstDabPlusSuperframeMeta", sizeof (GstDabPlusSuperframeMeta),
+        gst_dabplus_superframe_meta_init,
+        NULL,
+        gst_dabplus_superframe_meta_transform);
+    g_once_init_leave ((GstMetaInfo **) & meta_info, (GstMetaInfo *) mi);
+  }
+
+  return meta_info;
+}
+
+/**
+ * gst_buffer_add_dabplus_superframe_meta:
+ * @buffer: A #GstBuffer.
+ *
+ * Attaches an empty superframe layout description to @buffer,
+ * to be filled by the caller.
+ *
+ * Returns: The #GstDabPlusSuperframeMeta added to @buffer.
+ */
+GstDabPlusSuperframeMeta *
+gst_buffer_add_dabplus_superframe_meta (GstBuffer * buffer)
+{
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  return (GstDabPlusSuperframeMeta *) gst_buffer_add_meta (buffer,
+      GST_DABPLUS_SUPERFRAME_META_INFO, NULL);
+}
+
+/**
+ * gst_dabplus_subchannel_meta_api_get_type:
+ *
+ * Returns: #GType of the #GstDabPlusSubchannelMeta API.
+ */
+GType
+gst_dabplus_subchannel_meta_api_get_type (void)
+{
+  static gsize type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstDabPlusSubchannelMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+
+  return type;
+}
+
+static gboolean
+gst_dabplus_subchannel_meta_init (GstMeta * meta, gpointer params,
+    GstBuffer * buffer)
+{
+  GstDabPlusSubchannelMeta *smeta = (GstDabPlusSubchannelMeta *) meta;
+
+  smeta->subchannel_id = 0;
+
+  return TRUE;
+}
+
+static gboolean
+gst_dabplus_subchannel_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstDabPlusSubchannelMeta *smeta = (GstDabPlusSubchannelMeta *) meta;
+
+  /* every part of the buffer belongs to the same subchannel */
+  if (GST_META_TRANSFORM_IS_COPY (type))
+    return gst_buffer_add_dabplus_subchannel_meta (dest,
+      smeta->subchannel_id) != NULL;
+
+  /* transform type not supported */
+  return FALSE;
+}
+
+/**
+ * gst_dabplus_subchannel_meta_get_info:
+ *
+ * Returns: #GstMetaInfo of #GstDabPlusSubchannelMeta.
+ */
+const GstMetaInfo *
+gst_dabplus_subchannel_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & meta_info)) {
+    const GstMetaInfo *mi = gst_meta_register (GST_DABPLUS_SUBCHANNEL_META_API_TYPE,
+        "GstDabPlusSubchannelMeta", sizeof (GstDabPlusSubchannelMeta),
+        gst_dabplus_subchannel_meta_init,
+        NULL,
+        gst_dabplus_subchannel_meta_transform);
+    g_once_init_leave ((GstMetaInfo **) & meta_info, (GstMetaInfo *) mi);
+  }
+
+  return meta_info;
+}
+
+/**
+ * gst_buffer_add_dabplus_subchannel_meta:
+ * @buffer: A #GstBuffer.
+ * @subchannel_id: Identifier of the subchannel the data of @buffer belongs to.
+ *
+ * Returns: The #GstDabPlusSubchannelMeta added to @buffer.
+ */
+GstDabPlusSubchannelMeta *
+gst_buffer_add_dabplus_subchannel_meta (GstBuffer * buffer, guint subchannel_id)
+{
+  GstDabPlusSubchannelMeta *smeta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  smeta = (GstDabPlusSubchannelMeta *) gst_buffer_add_meta (buffer,
+      GST_DABPLUS_SUBCHANNEL_META_INFO, NULL);
+  if (!smeta)
+    return NULL;
+
+  smeta->subchannel_id = subchannel_id;
+
+  return smeta;
+}
@@ -0,0 +1,142 @@
+/* GStreamer DAB Plus buffer metadata
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DABPLUSMETA_H__
+#define __GST_DABPLUSMETA_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_DABPLUS_ERASURE_META_API_TYPE (gst_dabplus_erasure_meta_api_get_type())
+#define GST_DABPLUS_ERASURE_META_INFO     (gst_dabplus_erasure_meta_get_info())
+
+#define GST_DABPLUS_SUPERFRAME_META_API_TYPE (gst_dabplus_superframe_meta_api_get_type())
+#define GST_DABPLUS_SUPERFRAME_META_INFO     (gst_dabplus_superframe_meta_get_info())
+
+#define GST_DABPLUS_SUBCHANNEL_META_API_TYPE (gst_dabplus_subchannel_meta_api_get_type())
+#define GST_DABPLUS_SUBCHANNEL_META_INFO     (gst_dabplus_subchannel_meta_get_info())
+
+#define GST_DABPLUS_SUPERFRAME_MAX_AUS 6
+
+typedef struct _GstDabPlusErasureMeta GstDabPlusErasureMeta;
+typedef struct _GstDabPlusSuperframeMeta GstDabPlusSuperframeMeta;
+typedef struct _GstDabPlusSubchannelMeta GstDabPlusSubchannelMeta;
+
+/**
+ * GstDabPlusErasureMeta:
+ * @meta: Parent #GstMeta.
+ * @offset: Position of the first described byte in the byte stream
+ *          (as counted from the beginning of the stream or from the start
+ *          of a bytes segment, i.e. the same way as GST_BUFFER_OFFSET).
+ * @size: Number of described bytes.
+ * @reliability: Reliability of every described byte,
+ *               0 - erased, 255 - fully reliable.
+ *
+ * Per-byte reliability hints (e.g. from a demodulator or an ETI source
+ * flagging bad frames) used to run errors-and-erasures Reed-Solomon decoding.
+ * Positions are absolute, so the hints survive buffers being merged
+ * or split before they reach the parser.
+ */
+struct _GstDabPlusErasureMeta {
+  GstMeta meta;
+
+  guint64 offset;
+  gsize size;
+  guint8 *reliability;
+};
+
+/**
+ * GstDabPlusSuperframeMeta:
+ * @meta: Parent #GstMeta.
+ * @dac_rate: 0 - 32 kHz, 1 - 48 kHz core sampling rate.
+ * @sbr_flag: Whether SBR is used.
+ * @aac_channel_mode: 0 - mono, 1 - stereo.
+ * @ps_flag: Whether parametric stereo is used.
+ * @mpeg_surround_config: MPEG Surround configuration (0 - not used).
+ * @num_aus: Number of access units in the superframe.
+ * @au: Position (from the beginning of the buffer) and size of every
+ *      access unit, CRC excluded, and whether its CRC was valid.
+ *
+ * Layout of a DAB+ superframe as found by the parser, attached to
+ * superframes forwarded as a whole (stream-format "superframe"), so that
+ * downstream elements can reach access units without parsing again.
+ */
+struct _GstDabPlusSuperframeMeta {
+  GstMeta meta;
+
+  guint dac_rate;
+  guint sbr_flag;
+  guint aac_channel_mode;
+  guint ps_flag;
+  guint mpeg_surround_config;
+  guint num_aus;
+  struct {
+    guint start;
+    guint size;
+    gboolean crc_ok;
+  } au[GST_DABPLUS_SUPERFRAME_MAX_AUS];
+};
+
+/**
+ * GstDabPlusSubchannelMeta:
+ * @meta: Parent #GstMeta.
+ * @subchannel_id: Identifier of the subchannel (SubChId, 0 - 63)
+ *                 the buffer data belongs to.
+ *
+ * Tags buffers of a stream multiplexing several subchannels
+ * (e.g. produced by an ETI demultiplexer), so that dabplusmultiparse
+ * can route them to the parser of their subchannel.
+ */
+struct _GstDabPlusSubchannelMeta {
+  GstMeta meta;
+
+  guint subchannel_id;
+};
+
+GType gst_dabplus_erasure_meta_api_get_type (void);
+
+const GstMetaInfo *gst_dabplus_erasure_meta_get_info (void);
+
+GstDabPlusErasureMeta *gst_buffer_add_dabplus_erasure_meta (GstBuffer * buffer,
+    guint64 offset, const guint8 * reliability, gsize size);
+
+GType gst_dabplus_superframe_meta_api_get_type (void);
+
+const GstMetaInfo *gst_dabplus_superframe_meta_get_info (void);
+
+GstDabPlusSuperframeMeta *gst_buffer_add_dabplus_superframe_meta (GstBuffer * buffer);
+
+#define gst_buffer_get_dabplus_superframe_meta(b) \
+  ((GstDabPlusSuperframeMeta *) gst_buffer_get_meta ((b), GST_DABPLUS_SUPERFRAME_META_API_TYPE))
+
+GType gst_dabplus_subchannel_meta_api_get_type (void);
+
+const GstMetaInfo *gst_dabplus_subchannel_meta_get_info (void);
+
+GstDabPlusSubchannelMeta *gst_buffer_add_dabplus_subchannel_meta (GstBuffer * buffer,
+    guint subchannel_id);
+
+#define gst_buffer_get_dabplus_subchannel_meta(b) \
+  ((GstDabPlusSubchannelMeta *) gst_buffer_get_meta ((b), GST_DABPLUS_SUBCHANNEL_META_API_TYPE))
+
+G_END_DECLS
+
+#endif /* __GST_DABPLUSMETA_H__ */
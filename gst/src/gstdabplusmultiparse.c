@@ -0,0 +1,1072 @@
+/* GStreamer DAB Plus multi subchannel parser
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-dabplusmultiparse
+ * @short_description: DAB Plus parser for many subchannels
+ * @see_also: #GstDabPlusParse
+ *
+ * Parses many DAB Plus subchannels multiplexed into one stream
+ * (e.g. by an ETI demultiplexer), every buffer being tagged with
+ * #GstDabPlusSubchannelMeta telling which subchannel its data belongs to.
+ * Each subchannel of interest is requested as a "src_%u" pad, where %u is
+ * the subchannel id; buffers of subchannels which were not requested
+ * are dropped.
+ *
+ * Every subchannel is parsed by its own #GstDabPlusParse (named "parse_%u",
+ * so its properties can be set through #GstChildProxy), but instead of
+ * a streaming thread and a queue per subchannel, the parsers are run by
+ * a small pool of worker threads (see #GstDabPlusMultiParse:n-threads).
+ * Data of one subchannel is processed by one worker at a time, in order,
+ * and that worker pushes the parser output downstream as well. While
+ * a worker is blocked downstream (e.g. by a sink prerolling in PAUSED),
+ * the pool is allowed one more thread, so the other subchannels keep
+ * being parsed; the pool shrinks back once the push returns.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 etisrc ! dabplusmultiparse name=m parse_2::bitrate=64 \
+ *     m.src_2 ! avdec_aac ! audioconvert ! autoaudiosink \
+ *     m.src_7 ! filesink location=subchannel07.aac
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include "gstdabplusmultiparse.h"
+#include "gstdabplusparse.h"
+#include "gstdabplusmeta.h"
+
+#define DEFAULT_N_THREADS       0   /* number of processors */
+
+#define SUBCHANNEL_MAX_QUEUED   64  /* buffers and events waiting for a parser */
+#define SUBCHANNEL_DRAIN_BATCH  16  /* items a worker takes before letting other subchannels in */
+
+enum
+{
+  PROP_0,
+  PROP_N_THREADS
+};
+
+/*
+ * GstDabPlusSubchannel:
+ *
+ * One requested subchannel. Data for the parser is queued by the streaming
+ * thread and pushed into the parser by a worker; 'scheduled' is set while
+ * a worker owns the subchannel, so only one worker runs its parser at a time.
+ * Parser output goes through 'outpad' to the request pad, in the thread
+ * of the parser.
+ */
+struct _GstDabPlusSubchannel {
+  gint refcount;
+
+  GstDabPlusMultiParse *multiparse; /* not referenced */
+  guint id;
+  GstElement *parse;
+  GstPad *pad;     /* feeds the parser, not added to the element */
+  GstPad *outpad;  /* takes parser output, not added to the element */
+  GstPad *srcpad;  /* request pad */
+
+  GMutex lock;
+  GCond cond;
+  GQueue queue;    /* buffers and serialized events */
+  gboolean scheduled;
+  gboolean flushing;
+  GstFlowReturn flow;
+};
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("audio/mpeg, "
+        "mpegversion = (int) 4, "
+        "rate = (int) [ 8000, 48000 ], "
+        "channels = (int) [ 1, 2 ], "
+        "stream-format = (string) { raw, adts, loas, superframe }, "
+        "framed = (boolean) true;"));
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/mpeg, "
+        "stream-format = (string) superframe;"));
+
+/* multiparse whose drain job the current thread is running */
+static GPrivate current_worker;
+
+GST_DEBUG_CATEGORY_STATIC (dabplusmultiparse_debug);
+#define GST_CAT_DEFAULT dabplusmultiparse_debug
+
+G_DEFINE_TYPE (GstDabPlusMultiParse, gst_dabplusmultiparse, GST_TYPE_BIN);
+
+static void gst_dabplusmultiparse_set_property (GObject * object, guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_dabplusmultiparse_get_property (GObject * object, guint prop_id, GValue * value, GParamSpec * pspec);
+static void gst_dabplusmultiparse_finalize     (GObject * object);
+
+static GstStateChangeReturn gst_dabplusmultiparse_change_state (GstElement * element, GstStateChange transition);
+static GstPad *gst_dabplusmultiparse_request_new_pad (GstElement * element, GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_dabplusmultiparse_release_pad  (GstElement * element, GstPad * pad);
+
+static GstFlowReturn gst_dabplusmultiparse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer);
+static gboolean gst_dabplusmultiparse_sink_event (GstPad * pad, GstObject * parent, GstEvent * event);
+
+static void gst_dabplusmultiparse_drain (gpointer data, gpointer user_data);
+
+/**
+ * gst_dabplusmultiparse_subchannel_ref:
+ * @sub: #GstDabPlusSubchannel.
+ *
+ * Returns: @sub.
+ */
+static GstDabPlusSubchannel *
+gst_dabplusmultiparse_subchannel_ref (GstDabPlusSubchannel * sub)
+{
+  g_atomic_int_inc (&sub->refcount);
+  return sub;
+}
+
+/**
+ * gst_dabplusmultiparse_subchannel_unref:
+ * @sub: #GstDabPlusSubchannel.
+ *
+ * Frees @sub when the last reference is dropped.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_subchannel_unref (GstDabPlusSubchannel * sub)
+{
+  if (!g_atomic_int_dec_and_test (&sub->refcount))
+    return;
+
+  g_queue_clear_full (&sub->queue, (GDestroyNotify) gst_mini_object_unref);
+  g_mutex_clear (&sub->lock);
+  g_cond_clear (&sub->cond);
+  gst_object_unref (sub->pad);
+  gst_object_unref (sub->outpad);
+  g_free (sub);
+}
+
+/**
+ * gst_dabplusmultiparse_get_subchannels:
+ * @multiparse: #GstDabPlusMultiParse.
+ *
+ * Returns: List of references to all requested subchannels,
+ *          to be freed with g_list_free_full (list, subchannel_unref).
+ */
+static GList *
+gst_dabplusmultiparse_get_subchannels (GstDabPlusMultiParse * multiparse)
+{
+  GList *subs = NULL;
+  GHashTableIter iter;
+  gpointer value;
+
+  GST_OBJECT_LOCK (multiparse);
+  g_hash_table_iter_init (&iter, multiparse->subchannels);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    subs = g_list_prepend (subs, gst_dabplusmultiparse_subchannel_ref (value));
+  GST_OBJECT_UNLOCK (multiparse);
+
+  return subs;
+}
+
+/**
+ * gst_dabplusmultiparse_subchannel_queue:
+ * @multiparse: #GstDabPlusMultiParse.
+ * @sub: #GstDabPlusSubchannel.
+ * @item: Buffer or serialized event for the parser of @sub (transfer full).
+ *
+ * Queues @item and makes sure a worker is going to push it. Waits while
+ * the queue is full, so that slow subchannels throttle upstream.
+ *
+ * Returns: Last flow return of the parser of @sub,
+ *          GST_FLOW_FLUSHING if @sub is flushing.
+ */
+static GstFlowReturn
+gst_dabplusmultiparse_subchannel_queue (GstDabPlusMultiParse * multiparse,
+    GstDabPlusSubchannel * sub, GstMiniObject * item)
+{
+  GstFlowReturn ret;
+  gboolean schedule = FALSE;
+
+  g_mutex_lock (&sub->lock);
+
+  while (!sub->flushing && (g_queue_get_length (&sub->queue) >= SUBCHANNEL_MAX_QUEUED))
+    g_cond_wait (&sub->cond, &sub->lock);
+
+  if (sub->flushing) {
+    g_mutex_unlock (&sub->lock);
+    gst_mini_object_unref (item);
+    return GST_FLOW_FLUSHING;
+  }
+
+  g_queue_push_tail (&sub->queue, item);
+  if (!sub->scheduled) {
+    sub->scheduled = TRUE;
+    schedule = TRUE;
+  }
+  ret = sub->flow;
+
+  g_mutex_unlock (&sub->lock);
+
+  if (schedule)
+    g_thread_pool_push (multiparse->pool,
+      gst_dabplusmultiparse_subchannel_ref (sub), NULL);
+
+  return ret;
+}
+
+/**
+ * gst_dabplusmultiparse_drain:
+ * @data: #GstDabPlusSubchannel scheduled for processing.
+ * @user_data: #GstDabPlusMultiParse.
+ *
+ * Worker function. Pushes queued buffers and events into the parser
+ * of a subchannel. After a batch of them, the subchannel is put
+ * at the end of the pool queue, so that busy subchannels
+ * don't starve the others.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_drain (gpointer data, gpointer user_data)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (user_data);
+  GstDabPlusSubchannel *sub = data;
+  GstMiniObject *item;
+  guint n;
+
+  g_private_set (&current_worker, multiparse);
+
+  for (n = 0; ; ++n) {
+    g_mutex_lock (&sub->lock);
+
+    item = g_queue_pop_head (&sub->queue);
+    if (!item) {
+      sub->scheduled = FALSE;
+      g_cond_broadcast (&sub->cond);
+      g_mutex_unlock (&sub->lock);
+      break;
+    }
+
+    if (n == SUBCHANNEL_DRAIN_BATCH) {
+      g_queue_push_head (&sub->queue, item);
+      g_mutex_unlock (&sub->lock);
+      /* keep being scheduled, pass our reference on */
+      g_private_set (&current_worker, NULL);
+      g_thread_pool_push (multiparse->pool, sub, NULL);
+      return;
+    }
+
+    g_cond_broadcast (&sub->cond);
+    g_mutex_unlock (&sub->lock);
+
+    if (GST_IS_BUFFER (item)) {
+      GstFlowReturn ret = gst_pad_push (sub->pad, GST_BUFFER_CAST (item));
+
+      g_mutex_lock (&sub->lock);
+      sub->flow = ret;
+      g_mutex_unlock (&sub->lock);
+
+      if (G_UNLIKELY (ret != GST_FLOW_OK))
+        GST_DEBUG_OBJECT (sub->pad, "subchannel %u: %s", sub->id,
+          gst_flow_get_name (ret));
+    } else
+      gst_pad_push_event (sub->pad, GST_EVENT_CAST (item));
+  }
+
+  g_private_set (&current_worker, NULL);
+  gst_dabplusmultiparse_subchannel_unref (sub);
+}
+
+/**
+ * gst_dabplusmultiparse_subchannel_set_flushing:
+ * @sub: #GstDabPlusSubchannel.
+ * @flushing: New flushing state.
+ *
+ * Sets flushing state of @sub. Entering the flushing state drops
+ * queued data and unblocks the streaming thread waiting for room
+ * in the queue.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_subchannel_set_flushing (GstDabPlusSubchannel * sub,
+    gboolean flushing)
+{
+  g_mutex_lock (&sub->lock);
+  sub->flushing = flushing;
+  if (flushing) {
+    g_queue_clear_full (&sub->queue, (GDestroyNotify) gst_mini_object_unref);
+    g_queue_init (&sub->queue);
+    g_cond_broadcast (&sub->cond);
+  } else
+    sub->flow = GST_FLOW_OK;
+  g_mutex_unlock (&sub->lock);
+}
+
+/**
+ * gst_dabplusmultiparse_subchannel_wait_idle:
+ * @sub: #GstDabPlusSubchannel.
+ *
+ * Waits until no worker is running the parser of @sub.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_subchannel_wait_idle (GstDabPlusSubchannel * sub)
+{
+  g_mutex_lock (&sub->lock);
+  while (sub->scheduled)
+    g_cond_wait (&sub->cond, &sub->lock);
+  g_mutex_unlock (&sub->lock);
+}
+
+/**
+ * gst_dabplusmultiparse_subchannel_start:
+ * @multiparse: #GstDabPlusMultiParse.
+ * @sub: #GstDabPlusSubchannel.
+ *
+ * Activates the pad feeding the parser of @sub and queues
+ * the initial sticky events.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_subchannel_start (GstDabPlusMultiParse * multiparse,
+    GstDabPlusSubchannel * sub)
+{
+  GstEvent *segment = NULL;
+  GstCaps *caps;
+  gchar *stream_id;
+
+  gst_pad_set_active (sub->outpad, TRUE);
+  gst_pad_set_active (sub->pad, TRUE);
+  gst_dabplusmultiparse_subchannel_set_flushing (sub, FALSE);
+
+  stream_id = gst_pad_create_stream_id_printf (multiparse->sinkpad,
+    GST_ELEMENT_CAST (multiparse), "%u", sub->id);
+  gst_dabplusmultiparse_subchannel_queue (multiparse, sub,
+    GST_MINI_OBJECT_CAST (gst_event_new_stream_start (stream_id)));
+  g_free (stream_id);
+
+  caps = gst_pad_get_pad_template_caps (multiparse->sinkpad);
+  gst_dabplusmultiparse_subchannel_queue (multiparse, sub,
+    GST_MINI_OBJECT_CAST (gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+
+  GST_OBJECT_LOCK (multiparse);
+  if (multiparse->have_segment)
+    segment = gst_event_new_segment (&multiparse->segment);
+  GST_OBJECT_UNLOCK (multiparse);
+
+  if (segment)
+    gst_dabplusmultiparse_subchannel_queue (multiparse, sub,
+      GST_MINI_OBJECT_CAST (segment));
+}
+
+/**
+ * gst_dabplusmultiparse_subchannel_stop:
+ * @sub: #GstDabPlusSubchannel.
+ *
+ * Drops queued data of @sub, waits for the worker running its parser
+ * and deactivates the pads around the parser.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_subchannel_stop (GstDabPlusSubchannel * sub)
+{
+  gst_dabplusmultiparse_subchannel_set_flushing (sub, TRUE);
+  gst_dabplusmultiparse_subchannel_wait_idle (sub);
+  gst_pad_set_active (sub->pad, FALSE);
+  gst_pad_set_active (sub->outpad, FALSE);
+}
+
+/**
+ * gst_dabplusmultiparse_update_pool:
+ * @multiparse: #GstDabPlusMultiParse.
+ *
+ * Sets the maximum number of workers: n-threads, plus one for every
+ * worker currently pushing downstream. Must be called with the object
+ * lock held.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_update_pool (GstDabPlusMultiParse * multiparse)
+{
+  guint n_threads = multiparse->n_threads ?
+    multiparse->n_threads : g_get_num_processors ();
+
+  g_thread_pool_set_max_threads (multiparse->pool,
+    n_threads + multiparse->n_pushing, NULL);
+}
+
+/**
+ * gst_dabplusmultiparse_push_begin:
+ * @multiparse: #GstDabPlusMultiParse.
+ *
+ * To be called before parser output is given downstream, which may block
+ * (e.g. a sink prerolling in PAUSED). When called from a worker, the pool
+ * gets one more thread for the time being, so that a subchannel blocked
+ * downstream doesn't keep the others waiting.
+ *
+ * Returns: Whether gst_dabplusmultiparse_push_end() has to give the thread back.
+ */
+static gboolean
+gst_dabplusmultiparse_push_begin (GstDabPlusMultiParse * multiparse)
+{
+  /* e.g. the emission thread of a parser, not taken from the pool */
+  if (g_private_get (&current_worker) != multiparse)
+    return FALSE;
+
+  GST_OBJECT_LOCK (multiparse);
+  multiparse->n_pushing++;
+  gst_dabplusmultiparse_update_pool (multiparse);
+  GST_OBJECT_UNLOCK (multiparse);
+
+  return TRUE;
+}
+
+/**
+ * gst_dabplusmultiparse_push_end:
+ * @multiparse: #GstDabPlusMultiParse.
+ * @worker: What gst_dabplusmultiparse_push_begin() returned.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_push_end (GstDabPlusMultiParse * multiparse,
+    gboolean worker)
+{
+  if (!worker)
+    return;
+
+  GST_OBJECT_LOCK (multiparse);
+  multiparse->n_pushing--;
+  gst_dabplusmultiparse_update_pool (multiparse);
+  GST_OBJECT_UNLOCK (multiparse);
+}
+
+/**
+ * gst_dabplusmultiparse_out_chain:
+ * @pad: Pad taking parser output.
+ * @parent: NULL.
+ * @buffer: Parsed buffer.
+ *
+ * Returns: a #GstFlowReturn.
+ */
+static GstFlowReturn
+gst_dabplusmultiparse_out_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstDabPlusSubchannel *sub = gst_pad_get_element_private (pad);
+  GstFlowReturn ret;
+  gboolean worker;
+
+  worker = gst_dabplusmultiparse_push_begin (sub->multiparse);
+  ret = gst_pad_push (sub->srcpad, buffer);
+  gst_dabplusmultiparse_push_end (sub->multiparse, worker);
+
+  return ret;
+}
+
+/**
+ * gst_dabplusmultiparse_out_chain_list:
+ * @pad: Pad taking parser output.
+ * @parent: NULL.
+ * @list: Parsed buffers, kept together as a list.
+ *
+ * Returns: a #GstFlowReturn.
+ */
+static GstFlowReturn
+gst_dabplusmultiparse_out_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstDabPlusSubchannel *sub = gst_pad_get_element_private (pad);
+  GstFlowReturn ret;
+  gboolean worker;
+
+  worker = gst_dabplusmultiparse_push_begin (sub->multiparse);
+  ret = gst_pad_push_list (sub->srcpad, list);
+  gst_dabplusmultiparse_push_end (sub->multiparse, worker);
+
+  return ret;
+}
+
+/**
+ * gst_dabplusmultiparse_out_event:
+ * @pad: Pad taking parser output.
+ * @parent: NULL.
+ * @event: #GstEvent.
+ *
+ * Returns: TRUE if the event was handled downstream.
+ */
+static gboolean
+gst_dabplusmultiparse_out_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstDabPlusSubchannel *sub = gst_pad_get_element_private (pad);
+  gboolean worker, res;
+
+  /* serialized events may block as well (e.g. eos while prerolling) */
+  worker = gst_dabplusmultiparse_push_begin (sub->multiparse);
+  res = gst_pad_push_event (sub->srcpad, event);
+  gst_dabplusmultiparse_push_end (sub->multiparse, worker);
+
+  return res;
+}
+
+/**
+ * gst_dabplusmultiparse_out_query:
+ * @pad: Pad taking parser output.
+ * @parent: NULL.
+ * @query: #GstQuery from the parser.
+ *
+ * Returns: TRUE if the query was answered downstream.
+ */
+static gboolean
+gst_dabplusmultiparse_out_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstDabPlusSubchannel *sub = gst_pad_get_element_private (pad);
+  gboolean worker, res;
+
+  worker = gst_dabplusmultiparse_push_begin (sub->multiparse);
+  res = gst_pad_peer_query (sub->srcpad, query);
+  gst_dabplusmultiparse_push_end (sub->multiparse, worker);
+
+  return res;
+}
+
+/**
+ * gst_dabplusmultiparse_src_event:
+ * @pad: Src pad of a subchannel.
+ * @parent: #GstDabPlusMultiParse.
+ * @event: Upstream #GstEvent.
+ *
+ * Returns: TRUE if the parser handled @event.
+ */
+static gboolean
+gst_dabplusmultiparse_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstDabPlusSubchannel *sub = gst_pad_get_element_private (pad);
+
+  return gst_pad_push_event (sub->outpad, event);
+}
+
+/**
+ * gst_dabplusmultiparse_src_query:
+ * @pad: Src pad of a subchannel.
+ * @parent: #GstDabPlusMultiParse.
+ * @query: #GstQuery from downstream.
+ *
+ * Returns: TRUE if the parser answered @query.
+ */
+static gboolean
+gst_dabplusmultiparse_src_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstDabPlusSubchannel *sub = gst_pad_get_element_private (pad);
+
+  return gst_pad_peer_query (sub->outpad, query);
+}
+
+/**
+ * gst_dabplusmultiparse_class_init:
+ * @klass: #GstDabPlusMultiParseClass.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_class_init (GstDabPlusMultiParseClass * klass)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (dabplusmultiparse_debug, "dabplusmultiparse", 0,
+    "dab+ multi subchannel parser");
+
+  gst_element_class_set_static_metadata (element_class,
+      "DAB+ multi subchannel parser", "Codec/Parser/Audio",
+      "Parses DAB+ audio super frames of many subchannels multiplexed into one stream",
+      "Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>");
+
+  gobject_class->set_property = gst_dabplusmultiparse_set_property;
+  gobject_class->get_property = gst_dabplusmultiparse_get_property;
+  gobject_class->finalize = gst_dabplusmultiparse_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of worker threads running subchannel parsers, "
+          "0 - number of processors",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&sink_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+
+  element_class->change_state = GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_change_state);
+  element_class->request_new_pad = GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_release_pad);
+}
+
+/**
+ * gst_dabplusmultiparse_init:
+ * @multiparse: #GstDabPlusMultiParse.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_init (GstDabPlusMultiParse * multiparse)
+{
+  multiparse->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (multiparse->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_chain));
+  gst_pad_set_event_function (multiparse->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_sink_event));
+  gst_element_add_pad (GST_ELEMENT (multiparse), multiparse->sinkpad);
+
+  multiparse->subchannels = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  multiparse->n_threads = DEFAULT_N_THREADS;
+  multiparse->n_pushing = 0;
+  multiparse->pool = g_thread_pool_new (gst_dabplusmultiparse_drain, multiparse,
+    g_get_num_processors (), FALSE, NULL);
+
+  gst_segment_init (&multiparse->segment, GST_FORMAT_UNDEFINED);
+  multiparse->have_segment = FALSE;
+  multiparse->running = FALSE;
+}
+
+/**
+ * gst_dabplusmultiparse_finalize:
+ * @object: #GObject.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_finalize (GObject * object)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (object);
+
+  /* all subchannels are flushing by now, no jobs are left */
+  g_thread_pool_free (multiparse->pool, FALSE, TRUE);
+  g_hash_table_unref (multiparse->subchannels);
+
+  G_OBJECT_CLASS (gst_dabplusmultiparse_parent_class)->finalize (object);
+}
+
+/**
+ * gst_dabplusmultiparse_set_property:
+ * @object: #GObject.
+ * @prop_id: Property id.
+ * @value: New value of the property.
+ * @pspec: #GParamSpec.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (object);
+  guint n_threads;
+
+  switch (prop_id) {
+    case PROP_N_THREADS:
+      n_threads = g_value_get_uint (value);
+      GST_OBJECT_LOCK (multiparse);
+      multiparse->n_threads = n_threads;
+      gst_dabplusmultiparse_update_pool (multiparse);
+      GST_OBJECT_UNLOCK (multiparse);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/**
+ * gst_dabplusmultiparse_get_property:
+ * @object: #GObject.
+ * @prop_id: Property id.
+ * @value: Set to the current value of the property.
+ * @pspec: #GParamSpec.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (object);
+
+  switch (prop_id) {
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (multiparse);
+      g_value_set_uint (value, multiparse->n_threads);
+      GST_OBJECT_UNLOCK (multiparse);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/**
+ * gst_dabplusmultiparse_request_new_pad:
+ * @element: #GstElement.
+ * @templ: #GstPadTemplate of the requested pad.
+ * @name: Requested pad name ("src_%u", %u being the subchannel id).
+ * @caps: Unused.
+ *
+ * Creates a parser for the subchannel and a src pad pushing its output.
+ *
+ * Returns: The new pad or NULL if the subchannel is already requested.
+ */
+static GstPad *
+gst_dabplusmultiparse_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (element);
+  GstDabPlusSubchannel *sub;
+  GstPad *target;
+  gchar *parse_name, *pad_name;
+  gboolean running;
+  guint id = 0;
+
+  GST_OBJECT_LOCK (multiparse);
+  if (name) {
+    if ((sscanf (name, "src_%u", &id) != 1) ||
+        g_hash_table_contains (multiparse->subchannels, GUINT_TO_POINTER (id))) {
+      GST_OBJECT_UNLOCK (multiparse);
+      GST_WARNING_OBJECT (multiparse, "cannot request pad '%s'", name);
+      return NULL;
+    }
+  } else {
+    while (g_hash_table_contains (multiparse->subchannels, GUINT_TO_POINTER (id)))
+      ++id;
+  }
+  GST_OBJECT_UNLOCK (multiparse);
+
+  sub = g_new0 (GstDabPlusSubchannel, 1);
+  sub->refcount = 1;
+  sub->multiparse = multiparse;
+  sub->id = id;
+  g_mutex_init (&sub->lock);
+  g_cond_init (&sub->cond);
+  g_queue_init (&sub->queue);
+  sub->scheduled = FALSE;
+  sub->flushing = TRUE;
+  sub->flow = GST_FLOW_OK;
+
+  parse_name = g_strdup_printf ("parse_%u", id);
+  sub->parse = GST_ELEMENT (g_object_new (GST_TYPE_DABPLUSPARSE,
+    "name", parse_name, NULL));
+  g_free (parse_name);
+
+  pad_name = g_strdup_printf ("sink_%u", id);
+  sub->pad = gst_pad_new (pad_name, GST_PAD_SRC);
+  g_free (pad_name);
+
+  gst_bin_add (GST_BIN (multiparse), sub->parse);
+
+  target = gst_element_get_static_pad (sub->parse, "sink");
+  gst_pad_link (sub->pad, target);
+  gst_object_unref (target);
+
+  pad_name = g_strdup_printf ("out_%u", id);
+  sub->outpad = gst_pad_new (pad_name, GST_PAD_SINK);
+  g_free (pad_name);
+  gst_pad_set_element_private (sub->outpad, sub);
+  gst_pad_set_chain_function (sub->outpad,
+      GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_out_chain));
+  gst_pad_set_chain_list_function (sub->outpad,
+      GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_out_chain_list));
+  gst_pad_set_event_function (sub->outpad,
+      GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_out_event));
+  gst_pad_set_query_function (sub->outpad,
+      GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_out_query));
+
+  target = gst_element_get_static_pad (sub->parse, "src");
+  gst_pad_link (target, sub->outpad);
+  gst_object_unref (target);
+
+  pad_name = g_strdup_printf ("src_%u", id);
+  sub->srcpad = gst_pad_new_from_template (templ, pad_name);
+  g_free (pad_name);
+  gst_pad_set_element_private (sub->srcpad, sub);
+  gst_pad_set_event_function (sub->srcpad,
+      GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_src_event));
+  gst_pad_set_query_function (sub->srcpad,
+      GST_DEBUG_FUNCPTR (gst_dabplusmultiparse_src_query));
+
+  GST_OBJECT_LOCK (multiparse);
+  g_hash_table_insert (multiparse->subchannels, GUINT_TO_POINTER (id), sub);
+  running = multiparse->running;
+  GST_OBJECT_UNLOCK (multiparse);
+
+  if (running)
+    gst_pad_set_active (sub->srcpad, TRUE);
+
+  gst_element_add_pad (element, sub->srcpad);
+  gst_element_sync_state_with_parent (sub->parse);
+
+  if (running)
+    gst_dabplusmultiparse_subchannel_start (multiparse, sub);
+
+  GST_INFO_OBJECT (multiparse, "subchannel %u requested", id);
+
+  return sub->srcpad;
+}
+
+/**
+ * gst_dabplusmultiparse_release_pad:
+ * @element: #GstElement.
+ * @pad: Request pad being released.
+ *
+ * Stops and removes the parser of the subchannel.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusmultiparse_release_pad (GstElement * element, GstPad * pad)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (element);
+  GstDabPlusSubchannel *sub = NULL;
+  GHashTableIter iter;
+  gpointer value;
+
+  GST_OBJECT_LOCK (multiparse);
+  g_hash_table_iter_init (&iter, multiparse->subchannels);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    if (((GstDabPlusSubchannel *) value)->srcpad == pad) {
+      sub = value;
+      g_hash_table_iter_remove (&iter);
+      break;
+    }
+  }
+  GST_OBJECT_UNLOCK (multiparse);
+
+  if (!sub)
+    return;
+
+  GST_INFO_OBJECT (multiparse, "subchannel %u released", sub->id);
+
+  /* the worker may be blocked downstream */
+  gst_dabplusmultiparse_subchannel_set_flushing (sub, TRUE);
+  gst_pad_push_event (sub->pad, gst_event_new_flush_start ());
+  gst_dabplusmultiparse_subchannel_stop (sub);
+
+  gst_pad_set_active (sub->srcpad, FALSE);
+  gst_element_remove_pad (element, sub->srcpad);
+  gst_element_set_state (sub->parse, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (multiparse), sub->parse);
+
+  gst_dabplusmultiparse_subchannel_unref (sub);
+}
+
+/**
+ * gst_dabplusmultiparse_change_state:
+ * @element: #GstElement.
+ * @transition: #GstStateChange.
+ *
+ * Returns: #GstStateChangeReturn.
+ */
+static GstStateChangeReturn
+gst_dabplusmultiparse_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (element);
+  GstStateChangeReturn ret;
+  GList *subs, *l;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      GST_OBJECT_LOCK (multiparse);
+      multiparse->running = FALSE;
+      GST_OBJECT_UNLOCK (multiparse);
+
+      /* parsers are deactivated below, unblock and stop workers first */
+      subs = gst_dabplusmultiparse_get_subchannels (multiparse);
+      for (l = subs; l; l = l->next)
+        gst_dabplusmultiparse_subchannel_stop (l->data);
+      g_list_free_full (subs, (GDestroyNotify) gst_dabplusmultiparse_subchannel_unref);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (gst_dabplusmultiparse_parent_class)->change_state (
+    element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      GST_OBJECT_LOCK (multiparse);
+      gst_segment_init (&multiparse->segment, GST_FORMAT_UNDEFINED);
+      multiparse->have_segment = FALSE;
+      multiparse->running = TRUE;
+      GST_OBJECT_UNLOCK (multiparse);
+
+      /* parsers are active now */
+      subs = gst_dabplusmultiparse_get_subchannels (multiparse);
+      for (l = subs; l; l = l->next)
+        gst_dabplusmultiparse_subchannel_start (multiparse, l->data);
+      g_list_free_full (subs, (GDestroyNotify) gst_dabplusmultiparse_subchannel_unref);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+/**
+ * gst_dabplusmultiparse_chain:
+ * @pad: Sink #GstPad.
+ * @parent: #GstDabPlusMultiParse.
+ * @buffer: Buffer tagged with #GstDabPlusSubchannelMeta.
+ *
+ * Routes @buffer to the parser of its subchannel.
+ *
+ * Returns: GST_FLOW_OK unless the subchannel parser failed fatally.
+ */
+static GstFlowReturn
+gst_dabplusmultiparse_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (parent);
+  GstDabPlusSubchannelMeta *meta;
+  GstDabPlusSubchannel *sub;
+  GstFlowReturn ret;
+
+  meta = gst_buffer_get_dabplus_subchannel_meta (buffer);
+  if (G_UNLIKELY (!meta)) {
+    GST_WARNING_OBJECT (multiparse, "buffer without subchannel meta, dropping");
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  GST_OBJECT_LOCK (multiparse);
+  sub = g_hash_table_lookup (multiparse->subchannels,
+    GUINT_TO_POINTER (meta->subchannel_id));
+  if (sub)
+    gst_dabplusmultiparse_subchannel_ref (sub);
+  GST_OBJECT_UNLOCK (multiparse);
+
+  if (!sub) {
+    /* subchannel not requested */
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  ret = gst_dabplusmultiparse_subchannel_queue (multiparse, sub,
+    GST_MINI_OBJECT_CAST (buffer));
+
+  gst_dabplusmultiparse_subchannel_unref (sub);
+
+  /* one subchannel going away (unlinked, released, eos)
+     must not stop the others, only fatal errors are passed on */
+  if (ret >= GST_FLOW_EOS)
+    ret = GST_FLOW_OK;
+
+  return ret;
+}
+
+/**
+ * gst_dabplusmultiparse_sink_event:
+ * @pad: Sink #GstPad.
+ * @parent: #GstDabPlusMultiParse.
+ * @event: #GstEvent.
+ *
+ * Serialized events are queued for every subchannel, so that they stay
+ * in order with the data, flushing events are applied right away.
+ * Stream start and caps are not forwarded, as every subchannel is
+ * a stream on its own.
+ *
+ * Returns: TRUE if the event was handled.
+ */
+static gboolean
+gst_dabplusmultiparse_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstDabPlusMultiParse *multiparse = GST_DABPLUSMULTIPARSE (parent);
+  GList *subs, *l;
+
+  GST_DEBUG_OBJECT (multiparse, "event: %" GST_PTR_FORMAT, event);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_STREAM_START:
+    case GST_EVENT_CAPS:
+      gst_event_unref (event);
+      return TRUE;
+    case GST_EVENT_SEGMENT:
+      GST_OBJECT_LOCK (multiparse);
+      gst_event_copy_segment (event, &multiparse->segment);
+      multiparse->have_segment = TRUE;
+      GST_OBJECT_UNLOCK (multiparse);
+      break;
+    default:
+      break;
+  }
+
+  subs = gst_dabplusmultiparse_get_subchannels (multiparse);
+
+  for (l = subs; l; l = l->next) {
+    GstDabPlusSubchannel *sub = l->data;
+
+    switch (GST_EVENT_TYPE (event)) {
+      case GST_EVENT_FLUSH_START:
+        gst_dabplusmultiparse_subchannel_set_flushing (sub, TRUE);
+        gst_pad_push_event (sub->pad, gst_event_ref (event));
+        gst_dabplusmultiparse_subchannel_wait_idle (sub);
+        break;
+      case GST_EVENT_FLUSH_STOP:
+        gst_pad_push_event (sub->pad, gst_event_ref (event));
+        gst_dabplusmultiparse_subchannel_set_flushing (sub, FALSE);
+        break;
+      default:
+        if (GST_EVENT_IS_SERIALIZED (event))
+          gst_dabplusmultiparse_subchannel_queue (multiparse, sub,
+            GST_MINI_OBJECT_CAST (gst_event_ref (event)));
+        else
+          gst_pad_push_event (sub->pad, gst_event_ref (event));
+        break;
+    }
+  }
+
+  g_list_free_full (subs, (GDestroyNotify) gst_dabplusmultiparse_subchannel_unref);
+  gst_event_unref (event);
+
+  return TRUE;
+}
@@ -0,0 +1,78 @@
+/* GStreamer DAB Plus multi subchannel parser
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DABPLUSMULTIPARSE_H__
+#define __GST_DABPLUSMULTIPARSE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_DABPLUSMULTIPARSE            (gst_dabplusmultiparse_get_type())
+#define GST_DABPLUSMULTIPARSE(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_DABPLUSMULTIPARSE, GstDabPlusMultiParse))
+#define GST_DABPLUSMULTIPARSE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass),  GST_TYPE_DABPLUSMULTIPARSE, GstDabPlusMultiParseClass))
+#define GST_IS_DABPLUSMULTIPARSE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_DABPLUSMULTIPARSE))
+#define GST_IS_DABPLUSMULTIPARSE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass),  GST_TYPE_DABPLUSMULTIPARSE))
+
+typedef struct _GstDabPlusSubchannel       GstDabPlusSubchannel;
+typedef struct _GstDabPlusMultiParse       GstDabPlusMultiParse;
+typedef struct _GstDabPlusMultiParseClass  GstDabPlusMultiParseClass;
+
+/**
+ * GstDabPlusMultiParse:
+ *
+ * The opaque GstDabPlusMultiParse data structure.
+ */
+struct _GstDabPlusMultiParse {
+  GstBin bin;
+
+  GstPad *sinkpad;
+
+  /* Requested subchannels by subchannel id, protected by the object lock */
+  GHashTable *subchannels;
+
+  /* Workers running the subchannel parsers, n_threads of them plus
+     n_pushing (workers blocked downstream), protected by the object lock */
+  GThreadPool *pool;
+  guint n_threads;
+  guint n_pushing;
+
+  /* Last segment from upstream, given to subchannels requested later on.
+     Protected by the object lock, as is 'running' */
+  GstSegment segment;
+  gboolean have_segment;
+  gboolean running; /* PAUSED or PLAYING */
+};
+
+/**
+ * GstDabPlusMultiParseClass:
+ * @parent_class: Element's parent class.
+ *
+ * The opaque GstDabPlusMultiParseClass data structure.
+ */
+struct _GstDabPlusMultiParseClass {
+  GstBinClass parent_class;
+};
+
+GType gst_dabplusmultiparse_get_type (void);
+
+G_END_DECLS
+
+#endif /* __GST_DABPLUSMULTIPARSE_H__ */
@@ -25,6 +25,21 @@
  *
  * This is a DAB Plus parser which handles DAB Plus Audio Super Frames.
  * In fact DAB Plus Audio Super Frames carry MPEG4 HE AAC coded Access Units as their payload.
+ * Every superframe is checked against its Reed-Solomon parity (RS(120, 110))
+ * and, if needed, up to 5 erroneous bytes per codeword are corrected
+ * before the superframe header and access units are parsed.
+ * Upstream elements which know which bytes are unreliable (e.g. demodulators
+ * or ETI sources flagging bad frames) can attach #GstDabPlusErasureMeta to
+ * their buffers, which raises the limit to up to 10 erased bytes per codeword
+ * (see #GstDabPlusParse:erasure-threshold).
+ * Access units are then verified against their CRC-16 and the ones which
+ * fail are dropped, marked as corrupted or pushed unchanged
+ * (see #GstDabPlusParse:au-crc-mode).
+ * Access units of one superframe can be pushed downstream either one by one
+ * or in a single #GstBufferList (see #GstDabPlusParse:buffer-list).
+ * With "superframe" src stream-format the validated and corrected superframe
+ * is forwarded as a whole, with #GstDabPlusSuperframeMeta describing
+ * its access units.
  *
  * <refsect2>
  * <title>Example launch line</title>
@@ -32,6 +47,31 @@
  * gst-launch-1.0 filesrc location=subchannel02.raw ! dabplusparse ! avdec_aac ! audioresample ! audioconvert ! autoaudiosink
  * ]|
  * </refsect2>
+ *
+ * If the subchannel size is already known (e.g. from FIC or ETI configuration)
+ * it can be given either by the #GstDabPlusParse:superframe-size or
+ * #GstDabPlusParse:bitrate property, or by an upstream element through the
+ * "superframe-size" or "bitrate" (kbit/s) field of the sink caps.
+ * Superframe size detection is then skipped and the first superframe with
+ * valid firecode is parsed right away.
+ * |[
+ * gst-launch-1.0 filesrc location=subchannel03.raw ! dabplusparse bitrate=40 ! avdec_aac ! audioresample ! audioconvert ! autoaudiosink
+ * ]|
+ *
+ * When reprocessing recordings, #GstDabPlusParse:parallel spreads
+ * Reed-Solomon correction and CRC checks of superframes over all processor
+ * cores. Superframes are taken in batches once the superframe size is known,
+ * so this adds latency and is meant for files rather than live sources.
+ * |[
+ * gst-launch-1.0 filesrc location=subchannel03.raw ! dabplusparse parallel=true ! filesink location=subchannel03.aac
+ * ]|
+ *
+ * With #GstDabPlusParse:pipeline-depth set, access units are pushed
+ * downstream by a separate thread, so that checking further superframes
+ * goes on while downstream is busy. Up to pipeline-depth superframes
+ * are queued, serialized events and caps changes wait until all of them
+ * have been pushed. Pushed access units are still clipped to the segment
+ * and update its position, as in the base class.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -41,62 +81,107 @@
 #include <string.h>
 
 #include <gst/base/gstbitreader.h>
+#include <gst/base/gstbitwriter.h>
 #include <gst/pbutils/pbutils.h>
 #include "gstdabplusparse.h"
+#include "gstdabpluscrc.h"
+#include "gstdabplusrs.h"
+#include "gstdabplusmeta.h"
+#include "gstdabpluspool.h"
+#include "gstdabplusindex.h"
 
 #define RS_CODE_SIZE           10
 #define SUPERFRAME_MIN_SIZE		120
 #define N_MAX                 216
 #define SUPERFRAME_MAX_SIZE		(SUPERFRAME_MIN_SIZE * N_MAX)
-#define FIRECODE_LENGTH	       11
 #define MPEGVERSION             4   /* Superframe carries audio coded by MPEG 4 HE AAC v2 */
 #define DABPLUS_HEADER_LENGTH  12
 #define ADTS_HEADER_LENGTH      7   /* Total byte-length of fixed and variable adts header
                                        prepended during raw to adts conversion */
+#define LOAS_HEADER_LENGTH      3   /* syncword and audioMuxLengthBytes */
+#define LOAS_MAX_MUX_LENGTH  8191   /* maximum audioMuxLengthBytes */
+#define LOAS_MUX_CONFIG_BITS   45   /* useSameStreamMux and StreamMuxConfig */
+#define ASC_FRAME_LENGTH_960 (1 << 2) /* GASpecificConfig frameLengthFlag, DAB+ access
+                                       units carry 960 (not 1024) samples */
+#define BITRATE_STEP            8   /* Subchannel bitrate (kbit/s) carried by
+                                       SUPERFRAME_MIN_SIZE bytes of superframe */
+
+#define DETECT_MAX_HITS        64   /* How many firecode hits are considered during detection */
+
+#define DEFAULT_SUPERFRAME_SIZE 0
+#define DEFAULT_BITRATE         0
+#define DEFAULT_MAX_SYNC_MISSES 3
+#define DEFAULT_ERASURE_THRESHOLD 128
+#define DEFAULT_AU_CRC_MODE     DABPLUS_AU_CRC_DROP
+#define DEFAULT_BUFFER_LIST     FALSE
+#define DEFAULT_INDEX_LOCATION  NULL
+#define DEFAULT_PARALLEL        FALSE
+#define DEFAULT_PIPELINE_DEPTH  0
+#define MAX_PIPELINE_DEPTH      1024
+
+#define SUPERFRAME_DURATION     (120 * GST_MSECOND)
+
+enum
+{
+  PROP_0,
+  PROP_SUPERFRAME_SIZE,
+  PROP_BITRATE,
+  PROP_MAX_SYNC_MISSES,
+  PROP_SYNC_CONFIDENCE,
+  PROP_ERASURE_THRESHOLD,
+  PROP_AU_CRC_MODE,
+  PROP_BUFFER_LIST,
+  PROP_STATS,
+  PROP_INDEX_LOCATION,
+  PROP_PARALLEL,
+  PROP_PIPELINE_DEPTH
+};
+
+#define GST_TYPE_DABPLUSPARSE_AU_CRC_MODE (gst_dabplusparse_au_crc_mode_get_type ())
+static GType
+gst_dabplusparse_au_crc_mode_get_type (void)
+{
+  static gsize au_crc_mode_type = 0;
+  static const GEnumValue au_crc_modes[] = {
+    {DABPLUS_AU_CRC_PASS, "Push access units with invalid CRC unchanged", "pass"},
+    {DABPLUS_AU_CRC_FLAG, "Mark access units with invalid CRC as corrupted", "flag"},
+    {DABPLUS_AU_CRC_DROP, "Drop access units with invalid CRC", "drop"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&au_crc_mode_type)) {
+    GType _type = g_enum_register_static ("GstDabPlusAuCrcMode", au_crc_modes);
+    g_once_init_leave (&au_crc_mode_type, _type);
+  }
+
+  return au_crc_mode_type;
+}
 
 G_DEFINE_TYPE (GstDabPlusParse, gst_dabplusparse, GST_TYPE_BASE_PARSE);
 
-/* The polynomial is: x^16 + x^14 + x^13 + x^12 + x^11 + x^5 + x^3 + x^2 + x + 1 */
-static const guint16 gst_dabplusparse_firecode_crc_table[256] = {
-  0x0000, 0x782f, 0xf05e, 0x8871, 0x9893, 0xe0bc, 0x68cd, 0x10e2,
-  0x4909, 0x3126, 0xb957, 0xc178, 0xd19a, 0xa9b5, 0x21c4, 0x59eb,
-  0x9212, 0xea3d, 0x624c, 0x1a63, 0x0a81, 0x72ae, 0xfadf, 0x82f0,
-  0xdb1b, 0xa334, 0x2b45, 0x536a, 0x4388, 0x3ba7, 0xb3d6, 0xcbf9,
-  0x5c0b, 0x2424, 0xac55, 0xd47a, 0xc498, 0xbcb7, 0x34c6, 0x4ce9,
-  0x1502, 0x6d2d, 0xe55c, 0x9d73, 0x8d91, 0xf5be, 0x7dcf, 0x05e0,
-  0xce19, 0xb636, 0x3e47, 0x4668, 0x568a, 0x2ea5, 0xa6d4, 0xdefb,
-  0x8710, 0xff3f, 0x774e, 0x0f61, 0x1f83, 0x67ac, 0xefdd, 0x97f2,
-  0xb816, 0xc039, 0x4848, 0x3067, 0x2085, 0x58aa, 0xd0db, 0xa8f4,
-  0xf11f, 0x8930, 0x0141, 0x796e, 0x698c, 0x11a3, 0x99d2, 0xe1fd,
-  0x2a04, 0x522b, 0xda5a, 0xa275, 0xb297, 0xcab8, 0x42c9, 0x3ae6,
-  0x630d, 0x1b22, 0x9353, 0xeb7c, 0xfb9e, 0x83b1, 0x0bc0, 0x73ef,
-  0xe41d, 0x9c32, 0x1443, 0x6c6c, 0x7c8e, 0x04a1, 0x8cd0, 0xf4ff,
-  0xad14, 0xd53b, 0x5d4a, 0x2565, 0x3587, 0x4da8, 0xc5d9, 0xbdf6,
-  0x760f, 0x0e20, 0x8651, 0xfe7e, 0xee9c, 0x96b3, 0x1ec2, 0x66ed,
-  0x3f06, 0x4729, 0xcf58, 0xb777, 0xa795, 0xdfba, 0x57cb, 0x2fe4,
-  0x0803, 0x702c, 0xf85d, 0x8072, 0x9090, 0xe8bf, 0x60ce, 0x18e1,
-  0x410a, 0x3925, 0xb154, 0xc97b, 0xd999, 0xa1b6, 0x29c7, 0x51e8,
-  0x9a11, 0xe23e, 0x6a4f, 0x1260, 0x0282, 0x7aad, 0xf2dc, 0x8af3,
-  0xd318, 0xab37, 0x2346, 0x5b69, 0x4b8b, 0x33a4, 0xbbd5, 0xc3fa,
-  0x5408, 0x2c27, 0xa456, 0xdc79, 0xcc9b, 0xb4b4, 0x3cc5, 0x44ea,
-  0x1d01, 0x652e, 0xed5f, 0x9570, 0x8592, 0xfdbd, 0x75cc, 0x0de3,
-  0xc61a, 0xbe35, 0x3644, 0x4e6b, 0x5e89, 0x26a6, 0xaed7, 0xd6f8,
-  0x8f13, 0xf73c, 0x7f4d, 0x0762, 0x1780, 0x6faf, 0xe7de, 0x9ff1,
-  0xb015, 0xc83a, 0x404b, 0x3864, 0x2886, 0x50a9, 0xd8d8, 0xa0f7,
-  0xf91c, 0x8133, 0x0942, 0x716d, 0x618f, 0x19a0, 0x91d1, 0xe9fe,
-  0x2207, 0x5a28, 0xd259, 0xaa76, 0xba94, 0xc2bb, 0x4aca, 0x32e5,
-  0x6b0e, 0x1321, 0x9b50, 0xe37f, 0xf39d, 0x8bb2, 0x03c3, 0x7bec,
-  0xec1e, 0x9431, 0x1c40, 0x646f, 0x748d, 0x0ca2, 0x84d3, 0xfcfc,
-  0xa517, 0xdd38, 0x5549, 0x2d66, 0x3d84, 0x45ab, 0xcdda, 0xb5f5,
-  0x7e0c, 0x0623, 0x8e52, 0xf67d, 0xe69f, 0x9eb0, 0x16c1, 0x6eee,
-  0x3705, 0x4f2a, 0xc75b, 0xbf74, 0xaf96, 0xd7b9, 0x5fc8, 0x27e7
-};
+/* GObject methods */
+static void gst_dabplusparse_set_property            (GObject * object, guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_dabplusparse_get_property            (GObject * object, guint prop_id, GValue * value, GParamSpec * pspec);
+static void gst_dabplusparse_finalize                (GObject * object);
 
 /* GstBaseParse methods */
 static gboolean gst_dabplusparse_start               (GstBaseParse * baseparse);
 static gboolean gst_dabplusparse_stop                (GstBaseParse * baseparse);
+static gboolean gst_dabplusparse_set_sink_caps       (GstBaseParse * baseparse, GstCaps * caps);
 static GstCaps *gst_dabplusparse_sink_getcaps        (GstBaseParse * baseparse, GstCaps * filter);
 static GstFlowReturn gst_dabplusparse_handle_frame   (GstBaseParse * baseparse, GstBaseParseFrame * frame, gint * skipsize);
+static gboolean gst_dabplusparse_sink_event          (GstBaseParse * baseparse, GstEvent * event);
+static gboolean gst_dabplusparse_src_event           (GstBaseParse * baseparse, GstEvent * event);
+static gboolean gst_dabplusparse_convert             (GstBaseParse * baseparse, GstFormat src_format, gint64 src_value, GstFormat dest_format, gint64 * dest_value);
+
+static gboolean gst_dabplusparse_set_adts_header_template (GstDabPlusParse * dabplusparse, GstCaps * caps);
+static void gst_dabplusparse_clear_src_caps_cache (GstDabPlusParse * dabplusparse);
+static void gst_dabplusparse_clear_sink_caps_cache (GstDabPlusParse * dabplusparse);
+static void gst_dabplusparse_src_link_changed (GstPad * pad, GstPad * peer, gpointer user_data);
+static void gst_dabplusparse_check_job (gpointer data, gpointer user_data);
+static void gst_dabplusparse_emit_start (GstDabPlusParse * dabplusparse, guint depth);
+static void gst_dabplusparse_emit_stop (GstDabPlusParse * dabplusparse);
+static void gst_dabplusparse_emit_drain (GstDabPlusParse * dabplusparse);
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -105,7 +190,7 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
         "mpegversion = (int) 4, "
         "rate = (int) [ 8000, 48000 ], "
         "channels = (int) [ 1, 2 ], "
-        "stream-format = (string) { raw, adts }, "
+        "stream-format = (string) { raw, adts, loas, superframe }, "
         "framed = (boolean) true;"));
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -130,19 +215,34 @@ gst_dabplusparse_reset (GstDabPlusParse * dabplusparse)
 {
   GST_INFO_OBJECT (dabplusparse, "resetting");
 
+  /* queued superframes are pushed with the state they were parsed with */
+  gst_dabplusparse_emit_drain (dabplusparse);
+
   dabplusparse->object_type = -1;
   dabplusparse->sample_rate = -1;
   dabplusparse->channels = -1;
 
   dabplusparse->i_header_type = DABPLUS_HEADER_NOT_PARSED;
   dabplusparse->o_header_type = DABPLUS_HEADER_NOT_PARSED;
+  dabplusparse->adts_header_valid = FALSE;
+  dabplusparse->next_pts = GST_CLOCK_TIME_NONE;
+  dabplusparse->next_offset = 0;
 
   dabplusparse->superframe_size = 0;
+  GST_OBJECT_LOCK (dabplusparse);
+  dabplusparse->sync_confidence = 0;
+  GST_OBJECT_UNLOCK (dabplusparse);
   memset (&dabplusparse->superframe_header, 0377,
     sizeof(dabplusparse->superframe_header));
 
+  dabplusparse->detect_window = 2 * SUPERFRAME_MIN_SIZE;
+  dabplusparse->sync_misses = 0;
+  dabplusparse->sync_offset = G_MAXUINT64;
+  dabplusparse->snap_pending = FALSE;
+  dabplusparse->lookbehind_offset = G_MAXUINT64;
+
   gst_base_parse_set_min_frame_size (GST_BASE_PARSE (dabplusparse),
-      SUPERFRAME_MAX_SIZE + FIRECODE_LENGTH);
+      dabplusparse->detect_window + FIRECODE_LENGTH);
 }
 
 /**
@@ -156,14 +256,99 @@ gst_dabplusparse_class_init (GstDabPlusParseClass * klass)
 {
   GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
   GstBaseParseClass *parse_class = GST_BASE_PARSE_CLASS (klass);
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  const gchar *find_firecode_kernel, *crc_ccitt_kernel;
 
   GST_DEBUG_CATEGORY_INIT (dabplusparse_debug, "dabplusparse", 0, "dab+ audio stream parser");
 
+  gst_dabplus_crc_get_kernel_names (&find_firecode_kernel, &crc_ccitt_kernel);
+  GST_INFO ("firecode kernel: %s, crc kernel: %s, rs syndrome kernel: %s",
+      find_firecode_kernel, crc_ccitt_kernel, gst_dabplus_rs_get_kernel_name ());
+
   gst_element_class_set_static_metadata (element_class,
       "DAB+ audio stream parser", "Codec/Parser/Audio",
-      "Parses DAB+ audio super frames giving raw aac or adts access units as the result",
+      "Parses DAB+ audio super frames giving raw aac, adts or loas access units as the result",
       "Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>");
 
+  gobject_class->set_property = gst_dabplusparse_set_property;
+  gobject_class->get_property = gst_dabplusparse_get_property;
+  gobject_class->finalize = gst_dabplusparse_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_SUPERFRAME_SIZE,
+      g_param_spec_uint ("superframe-size", "Superframe size",
+          "Size of the superframe in bytes (multiple of 120), 0 - autodetect",
+          0, SUPERFRAME_MAX_SIZE, DEFAULT_SUPERFRAME_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BITRATE,
+      g_param_spec_uint ("bitrate", "Bitrate",
+          "Bitrate of the subchannel in kbit/s (multiple of 8), 0 - autodetect",
+          0, N_MAX * BITRATE_STEP, DEFAULT_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_SYNC_MISSES,
+      g_param_spec_uint ("max-sync-misses", "Max sync misses",
+          "Number of consecutive superframes with invalid header which are skipped "
+          "(keeping the superframe size) before full resynchronisation is started",
+          0, G_MAXUINT, DEFAULT_MAX_SYNC_MISSES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SYNC_CONFIDENCE,
+      g_param_spec_uint ("sync-confidence", "Sync confidence",
+          "Percentage of superframe headers found during detection which were "
+          "consistent with the detected superframe size (0 - not locked)",
+          0, 100, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ERASURE_THRESHOLD,
+      g_param_spec_uint ("erasure-threshold", "Erasure threshold",
+          "Bytes with reliability (as given by GstDabPlusErasureMeta attached to "
+          "input buffers) below this value are treated as erasures "
+          "by Reed-Solomon decoding, 0 - ignore reliability hints",
+          0, 256, DEFAULT_ERASURE_THRESHOLD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_AU_CRC_MODE,
+      g_param_spec_enum ("au-crc-mode", "AU CRC mode",
+          "What to do with access units failing CRC verification",
+          GST_TYPE_DABPLUSPARSE_AU_CRC_MODE, DEFAULT_AU_CRC_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BUFFER_LIST,
+      g_param_spec_boolean ("buffer-list", "Buffer list",
+          "Push all access units of a superframe downstream as one buffer list "
+          "(clipped to the segment and tracked for position queries by the "
+          "element, as they bypass the base class)",
+          DEFAULT_BUFFER_LIST, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Output buffer pool statistics (pool-hits, pool-misses)",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index location",
+          "Sidecar superframe index of the recording, used for seeking if it "
+          "exists, is complete and was built from a recording of the same size, "
+          "otherwise written during the first parse "
+          "(NULL - no index)",
+          DEFAULT_INDEX_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PARALLEL,
+      g_param_spec_boolean ("parallel", "Parallel",
+          "Check superframes on all processor cores, in batches of up to "
+          G_STRINGIFY (DABPLUS_PARALLEL_SUPERFRAMES) " superframes (meant for "
+          "offline processing, takes effect on the next start)",
+          DEFAULT_PARALLEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PIPELINE_DEPTH,
+      g_param_spec_uint ("pipeline-depth", "Pipeline depth",
+          "Number of superframes queued for a separate thread pushing them "
+          "downstream, clipped to the segment (0 - push from the streaming "
+          "thread, takes effect on the next start)",
+          0, MAX_PIPELINE_DEPTH, DEFAULT_PIPELINE_DEPTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&sink_template));
   gst_element_class_add_pad_template (element_class,
@@ -171,8 +356,12 @@ gst_dabplusparse_class_init (GstDabPlusParseClass * klass)
 
   parse_class->start = GST_DEBUG_FUNCPTR (gst_dabplusparse_start);
   parse_class->stop = GST_DEBUG_FUNCPTR (gst_dabplusparse_stop);
+  parse_class->set_sink_caps = GST_DEBUG_FUNCPTR (gst_dabplusparse_set_sink_caps);
   parse_class->get_sink_caps = GST_DEBUG_FUNCPTR (gst_dabplusparse_sink_getcaps);
   parse_class->handle_frame = GST_DEBUG_FUNCPTR (gst_dabplusparse_handle_frame);
+  parse_class->sink_event = GST_DEBUG_FUNCPTR (gst_dabplusparse_sink_event);
+  parse_class->src_event = GST_DEBUG_FUNCPTR (gst_dabplusparse_src_event);
+  parse_class->convert = GST_DEBUG_FUNCPTR (gst_dabplusparse_convert);
 }
 
 /**
@@ -184,668 +373,3306 @@ gst_dabplusparse_class_init (GstDabPlusParseClass * klass)
 static void
 gst_dabplusparse_init (GstDabPlusParse * dabplusparse)
 {
+  dabplusparse->configured_superframe_size = DEFAULT_SUPERFRAME_SIZE;
+  dabplusparse->caps_superframe_size = 0;
+  dabplusparse->max_sync_misses = DEFAULT_MAX_SYNC_MISSES;
+  dabplusparse->erasure_threshold = DEFAULT_ERASURE_THRESHOLD;
+  dabplusparse->au_crc_mode = DEFAULT_AU_CRC_MODE;
+  dabplusparse->pool = NULL;
+  dabplusparse->buffer_list = DEFAULT_BUFFER_LIST;
+  dabplusparse->index_location = g_strdup (DEFAULT_INDEX_LOCATION);
+  dabplusparse->index = NULL;
+  dabplusparse->index_writer = NULL;
+  dabplusparse->index_writing = FALSE;
+  dabplusparse->index_pending = FALSE;
+  memset (dabplusparse->sink_caps_cache, 0, sizeof (dabplusparse->sink_caps_cache));
+  dabplusparse->sink_caps_cache_next = 0;
+  dabplusparse->caps_cookie = 0;
+  memset (dabplusparse->src_caps_cache, 0, sizeof (dabplusparse->src_caps_cache));
+  dabplusparse->src_caps_cache_type = DABPLUS_HEADER_NOT_PARSED;
+  dabplusparse->src_caps_cache_cookie = 0;
+  dabplusparse->parallel = DEFAULT_PARALLEL;
+  dabplusparse->workers = NULL;
+  g_mutex_init (&dabplusparse->parallel_lock);
+  g_cond_init (&dabplusparse->parallel_cond);
+  memset (dabplusparse->jobs, 0, sizeof (dabplusparse->jobs));
+  dabplusparse->pipeline_depth = DEFAULT_PIPELINE_DEPTH;
+  dabplusparse->emit_depth = 0;
+  dabplusparse->emit_ring = NULL;
+  dabplusparse->emit_thread = NULL;
+  dabplusparse->emit_probe = 0;
+  g_mutex_init (&dabplusparse->emit_lock);
+  g_cond_init (&dabplusparse->emit_cond);
+  dabplusparse->emit_waiting = 0;
+
   gst_dabplusparse_reset(dabplusparse);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (dabplusparse));
+  g_signal_connect (GST_BASE_PARSE_SRC_PAD (dabplusparse), "linked",
+    G_CALLBACK (gst_dabplusparse_src_link_changed), dabplusparse);
+  g_signal_connect (GST_BASE_PARSE_SRC_PAD (dabplusparse), "unlinked",
+    G_CALLBACK (gst_dabplusparse_src_link_changed), dabplusparse);
   GST_INFO_OBJECT (dabplusparse, "init done");
 }
 
 /**
- * gst_dabplusparse_set_src_caps:
- * @dabplusparse: #GstDabPlusParse.
- *
- * Set source pad caps according to current knowledge about the
- * audio stream.
+ * gst_dabplusparse_set_property:
+ * @object: #GObject.
+ * @prop_id: Property id.
+ * @value: New value of the property.
+ * @pspec: #GParamSpec.
  *
- * Returns: TRUE if caps were successfully set.
+ * Returns: None.
  */
-static gboolean
-gst_dabplusparse_set_src_caps (GstDabPlusParse * dabplusparse)
+static void
+gst_dabplusparse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
 {
-  GstStructure *s;
-  GstCaps *src_caps = NULL, *allowed;
-  gboolean res = FALSE;
-  guint8 codec_data_table[2];
-  guint16 codec_data;
-  gint sample_rate_idx;
-
-  GST_DEBUG_OBJECT (dabplusparse, "setting src caps ...");
+  GstDabPlusParse *dabplusparse = GST_DABPLUSPARSE (object);
+  guint superframe_size;
 
-  sample_rate_idx =
-      gst_codec_utils_aac_get_index_from_sample_rate (dabplusparse->sample_rate);
-  if (G_UNLIKELY (sample_rate_idx < 0)) {
-    GST_ERROR_OBJECT (dabplusparse, "not a known sample rate: %d",
-      dabplusparse->sample_rate);
-    return FALSE;
+  switch (prop_id) {
+    case PROP_SUPERFRAME_SIZE:
+      superframe_size = g_value_get_uint (value);
+      break;
+    case PROP_MAX_SYNC_MISSES:
+      GST_OBJECT_LOCK (dabplusparse);
+      dabplusparse->max_sync_misses = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      return;
+    case PROP_ERASURE_THRESHOLD:
+      GST_OBJECT_LOCK (dabplusparse);
+      dabplusparse->erasure_threshold = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      return;
+    case PROP_AU_CRC_MODE:
+      GST_OBJECT_LOCK (dabplusparse);
+      dabplusparse->au_crc_mode = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      return;
+    case PROP_BUFFER_LIST:
+      GST_OBJECT_LOCK (dabplusparse);
+      dabplusparse->buffer_list = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      return;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_free (dabplusparse->index_location);
+      dabplusparse->index_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      return;
+    case PROP_PARALLEL:
+      GST_OBJECT_LOCK (dabplusparse);
+      dabplusparse->parallel = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      return;
+    case PROP_PIPELINE_DEPTH:
+      GST_OBJECT_LOCK (dabplusparse);
+      dabplusparse->pipeline_depth = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      return;
+    case PROP_BITRATE:
+      if (g_value_get_uint (value) % BITRATE_STEP) {
+        GST_WARNING_OBJECT (dabplusparse,
+          "bitrate %u is not multiple of %u, ignoring", g_value_get_uint (value), BITRATE_STEP);
+        return;
+      }
+      superframe_size = g_value_get_uint (value) / BITRATE_STEP * SUPERFRAME_MIN_SIZE;
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
   }
 
-  src_caps = gst_caps_new_empty_simple ("audio/mpeg");
-  s = gst_caps_get_structure (src_caps, 0);
-
-  gst_structure_set (s, "mpegversion", G_TYPE_INT, MPEGVERSION, NULL);
-  gst_structure_set (s, "framed", G_TYPE_BOOLEAN, TRUE, NULL);
+  if (superframe_size % SUPERFRAME_MIN_SIZE) {
+    GST_WARNING_OBJECT (dabplusparse,
+      "superframe size %u is not multiple of %u, ignoring", superframe_size, SUPERFRAME_MIN_SIZE);
+    return;
+  }
 
-  /* Generate codec data to be able to set profile/level on the caps */
-  codec_data =
-      (dabplusparse->object_type << 11) |
-      (sample_rate_idx << 7) | (dabplusparse->channels << 3);
-  GST_WRITE_UINT16_BE (codec_data_table, codec_data);
-  if (!gst_codec_utils_aac_caps_set_level_and_profile (src_caps,
-    codec_data_table, G_N_ELEMENTS(codec_data_table)))
-      GST_WARNING_OBJECT (dabplusparse,
-        "cannot set caps for object_type: %d, sample rate index: %d, channels: %d",
-          dabplusparse->object_type, sample_rate_idx, dabplusparse->channels);
+  GST_OBJECT_LOCK (dabplusparse);
+  dabplusparse->configured_superframe_size = superframe_size;
+  GST_OBJECT_UNLOCK (dabplusparse);
+}
 
-  if (dabplusparse->channels > 0)
-    gst_structure_set (s, "channels", G_TYPE_INT, dabplusparse->channels, NULL);
+/**
+ * gst_dabplusparse_get_stats:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Returns: Newly allocated #GstStructure with element statistics.
+ */
+static GstStructure *
+gst_dabplusparse_get_stats (GstDabPlusParse * dabplusparse)
+{
+  guint hits = 0, misses = 0;
 
-  GST_INFO_OBJECT (dabplusparse, "trying adts format first");
+  GST_OBJECT_LOCK (dabplusparse);
+  if (dabplusparse->pool)
+    gst_dabplus_au_pool_get_stats (GST_DABPLUS_AU_POOL (dabplusparse->pool),
+        &hits, &misses);
+  GST_OBJECT_UNLOCK (dabplusparse);
 
-  gst_structure_set (s, "stream-format", G_TYPE_STRING, "adts", NULL);
-  dabplusparse->o_header_type = DABPLUS_HEADER_ADTS;
+  return gst_structure_new ("application/x-dabplusparse-stats",
+      "pool-hits", G_TYPE_UINT, hits,
+      "pool-misses", G_TYPE_UINT, misses, NULL);
+}
 
-  allowed = gst_pad_get_allowed_caps (GST_BASE_PARSE (dabplusparse)->srcpad);
-  GST_DEBUG_OBJECT (dabplusparse, "allowed caps: %" GST_PTR_FORMAT, allowed);
+/**
+ * gst_dabplusparse_get_property:
+ * @object: #GObject.
+ * @prop_id: Property id.
+ * @value: Set to the current value of the property.
+ * @pspec: #GParamSpec.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstDabPlusParse *dabplusparse = GST_DABPLUSPARSE (object);
 
-  do {
-    if (gst_caps_can_intersect (src_caps, allowed))
+  switch (prop_id) {
+    case PROP_SUPERFRAME_SIZE:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_uint (value, dabplusparse->configured_superframe_size);
+      GST_OBJECT_UNLOCK (dabplusparse);
       break;
+    case PROP_BITRATE:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_uint (value,
+        dabplusparse->configured_superframe_size / SUPERFRAME_MIN_SIZE * BITRATE_STEP);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    case PROP_MAX_SYNC_MISSES:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_uint (value, dabplusparse->max_sync_misses);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    case PROP_SYNC_CONFIDENCE:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_uint (value, dabplusparse->sync_confidence);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    case PROP_ERASURE_THRESHOLD:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_uint (value, dabplusparse->erasure_threshold);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    case PROP_AU_CRC_MODE:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_enum (value, dabplusparse->au_crc_mode);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    case PROP_BUFFER_LIST:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_boolean (value, dabplusparse->buffer_list);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_dabplusparse_get_stats (dabplusparse));
+      break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_string (value, dabplusparse->index_location);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    case PROP_PARALLEL:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_boolean (value, dabplusparse->parallel);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    case PROP_PIPELINE_DEPTH:
+      GST_OBJECT_LOCK (dabplusparse);
+      g_value_set_uint (value, dabplusparse->pipeline_depth);
+      GST_OBJECT_UNLOCK (dabplusparse);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
 
-    GST_INFO_OBJECT (GST_BASE_PARSE (dabplusparse)->srcpad,
-      "caps can not intersect, trying raw format");
-
-    gst_structure_set (s, "stream-format", G_TYPE_STRING, "raw", NULL);
-    dabplusparse->o_header_type = DABPLUS_HEADER_RAW;
+/**
+ * gst_dabplusparse_finalize:
+ * @object: #GObject.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_finalize (GObject * object)
+{
+  GstDabPlusParse *dabplusparse = GST_DABPLUSPARSE (object);
 
-    if (gst_caps_can_intersect (src_caps, allowed)) {
-      /* The codec_data data is according to AudioSpecificConfig,
-         ISO/IEC 14496-3, 1.6.2.1 */
-      GstBuffer *codec_data_buffer =
-        gst_buffer_new_and_alloc (G_N_ELEMENTS(codec_data_table));
-      gst_buffer_fill (codec_data_buffer, 0,
-        codec_data_table, G_N_ELEMENTS(codec_data_table));
-      gst_caps_set_simple (src_caps, "codec_data", GST_TYPE_BUFFER,
-          codec_data_buffer, NULL);
-      gst_buffer_unref (codec_data_buffer);
+  g_free (dabplusparse->index_location);
 
-      break;
-    }
+  gst_dabplusparse_clear_sink_caps_cache (dabplusparse);
+  gst_dabplusparse_clear_src_caps_cache (dabplusparse);
 
-    GST_INFO_OBJECT (GST_BASE_PARSE (dabplusparse)->srcpad,
-      "Caps can not intersect, giving up");
+  g_mutex_clear (&dabplusparse->parallel_lock);
+  g_cond_clear (&dabplusparse->parallel_cond);
+  g_mutex_clear (&dabplusparse->emit_lock);
+  g_cond_clear (&dabplusparse->emit_cond);
 
-    gst_structure_remove_field(s, "stream-format");
-    dabplusparse->o_header_type = DABPLUS_HEADER_UNKNOWN;
+  G_OBJECT_CLASS (gst_dabplusparse_parent_class)->finalize (object);
+}
 
-  } while (0);
+/**
+ * gst_dabplusparse_get_known_superframe_size:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Superframe size given by the property takes precedence over
+ * the one announced in the sink caps.
+ *
+ * Returns: Superframe size known in advance, 0 if it needs to be detected.
+ */
+static guint
+gst_dabplusparse_get_known_superframe_size (GstDabPlusParse * dabplusparse)
+{
+  guint superframe_size;
 
-  if (allowed)
-    gst_caps_unref (allowed);
+  GST_OBJECT_LOCK (dabplusparse);
+  superframe_size = dabplusparse->configured_superframe_size;
+  GST_OBJECT_UNLOCK (dabplusparse);
 
-  GST_DEBUG_OBJECT (dabplusparse, "src caps: %" GST_PTR_FORMAT, src_caps);
+  if (superframe_size == 0)
+    superframe_size = dabplusparse->caps_superframe_size;
 
-  res = gst_pad_set_caps (GST_BASE_PARSE (dabplusparse)->srcpad, src_caps);
-  gst_caps_unref (src_caps);
-  return res;
+  return superframe_size;
 }
 
 /**
- * gst_dabplusparse_superframe_header_compare_audio_params:
- * @hdr1: #GstDabPlusSuperframeHeader.
- * @hdr2: #GstDabPlusSuperframeHeader.
- *
- * Resets 'dabplusparse' instance to its defaut state.
+ * gst_dabplusparse_get_pool_buffer_size:
+ * @dabplusparse: #GstDabPlusParse.
  *
- * Returns: TRUE if audio params are the same, FALSE otherwise.
+ * Returns: Size of the memory an output buffer needs on its own
+ *          in the negotiated stream format (access units are not counted
+ *          as their memory is shared with the superframe).
  */
-static gboolean
-gst_dabplusparse_superframe_header_compare_audio_params(
-  const GstDabPlusSuperframeHeader *hdr1,
-  const GstDabPlusSuperframeHeader *hdr2)
+static guint
+gst_dabplusparse_get_pool_buffer_size (GstDabPlusParse * dabplusparse)
 {
-  return (hdr1->dac_rate             == hdr2->dac_rate) &&
-         (hdr1->sbr_flag             == hdr2->sbr_flag) &&
-         (hdr1->aac_channel_mode     == hdr2->aac_channel_mode) &&
-         (hdr1->ps_flag              == hdr2->ps_flag) &&
-         (hdr1->mpeg_surround_config == hdr2->mpeg_surround_config);
+  switch (dabplusparse->o_header_type) {
+    case DABPLUS_HEADER_ADTS:
+      return ADTS_HEADER_LENGTH;
+    case DABPLUS_HEADER_LOAS:
+      return LOAS_HEADER_LENGTH + LOAS_MAX_MUX_LENGTH;
+    default:
+      return 0;
+  }
 }
 
-/* caller ensure sufficient data */
-static gboolean
-gst_dabplusparse_check_firecode (const guint8 * data)
+/**
+ * gst_dabplusparse_release_pool:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Deactivates and releases the output buffer pool, if there is one.
+ */
+static void
+gst_dabplusparse_release_pool (GstDabPlusParse * dabplusparse)
 {
-  gboolean retval = FALSE;
-
-  do {
-    guint16 firecode;
-    guint16 header_firecode;
-
-    firecode = 0;
-    header_firecode = (data[0] << 8) | (data[1] << 0);
+  GstBufferPool *pool;
 
-    for (gint i = 2; i < FIRECODE_LENGTH; ++i) {
-      /* XOR-in next input byte into MSB of 'firecode', that's our new intermediate divident */
-      guint8 pos = ((firecode >> 8) ^ data[i]);
-      /* Shift out the MSB used for division per lookuptable and XOR with the firecode */
-      firecode = (guint16)((firecode << 8) ^ gst_dabplusparse_firecode_crc_table[pos]);
-    }
+  GST_OBJECT_LOCK (dabplusparse);
+  pool = dabplusparse->pool;
+  dabplusparse->pool = NULL;
+  GST_OBJECT_UNLOCK (dabplusparse);
 
-    if (header_firecode != firecode)
-      break;
+  if (pool) {
+    gst_buffer_pool_set_active (pool, FALSE);
+    gst_object_unref (pool);
+  }
+}
 
-    /* all zeros will also generate zero firecode, hmmm */
-    if (firecode == 0)
-      break;
+/**
+ * gst_dabplusparse_decide_allocation:
+ * @dabplusparse: #GstDabPlusParse.
+ * @caps: Negotiated src caps.
+ *
+ * Sets up the output buffer pool for @caps. Downstream is asked with
+ * the ALLOCATION query for the allocator (used for header memory) and
+ * for the number of buffers it keeps around, which are then preallocated.
+ * Downstream pools are not used, since output buffers mostly consist
+ * of memory shared with the superframe.
+ */
+static void
+gst_dabplusparse_decide_allocation (GstDabPlusParse * dabplusparse,
+    GstCaps * caps)
+{
+  GstQuery *query;
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstAllocator *allocator = NULL;
+  GstAllocationParams params;
+  guint min_buffers = 0;
+
+  gst_dabplusparse_release_pool (dabplusparse);
+
+  gst_allocation_params_init (&params);
+
+  query = gst_query_new_allocation (caps, FALSE);
+  if (gst_pad_peer_query (GST_BASE_PARSE_SRC_PAD (dabplusparse), query)) {
+    if (gst_query_get_n_allocation_params (query) > 0)
+      gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
+    if (gst_query_get_n_allocation_pools (query) > 0)
+      gst_query_parse_nth_allocation_pool (query, 0, NULL, NULL, &min_buffers, NULL);
+  } else
+    GST_DEBUG_OBJECT (dabplusparse, "allocation query failed, using defaults");
+  gst_query_unref (query);
+
+  pool = gst_dabplus_au_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps,
+      gst_dabplusparse_get_pool_buffer_size (dabplusparse), min_buffers, 0);
+  gst_buffer_pool_config_set_allocator (config, allocator, &params);
+
+  if (allocator)
+    gst_object_unref (allocator);
+
+  if (!gst_buffer_pool_set_config (pool, config) ||
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    GST_WARNING_OBJECT (dabplusparse, "cannot activate buffer pool");
+    gst_object_unref (pool);
+    return;
+  }
 
-    retval = TRUE;
-  } while (0);
+  GST_DEBUG_OBJECT (dabplusparse, "buffer pool: size %u, min buffers %u",
+      gst_dabplusparse_get_pool_buffer_size (dabplusparse), min_buffers);
 
-  return retval;
+  GST_OBJECT_LOCK (dabplusparse);
+  dabplusparse->pool = pool;
+  GST_OBJECT_UNLOCK (dabplusparse);
 }
 
-/* caller ensure sufficient data */
-static inline gboolean
-gst_dabplusparse_parse_superframe_header (GstDabPlusSuperframeHeader *hdr,
-  const guint8 *data, guint framesize)
+/**
+ * gst_dabplusparse_get_audio_params:
+ * @hdr: #GstDabPlusSuperframeHeader.
+ * @object_type: Set to the AAC audio object type.
+ * @sample_rate: Set to the AAC core sampling rate.
+ * @channels: Set to the number of channels (0 - unknown).
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_get_audio_params (const GstDabPlusSuperframeHeader * hdr,
+    gint * object_type, gint * sample_rate, gint * channels)
 {
-  guint i;
-  guint aus_end;
-
-  hdr->header_firecode = (data[0] << 8) | (data[1] << 0);
-  hdr->rfa = !!(data[2] & 0x80);
-  hdr->dac_rate = !!(data[2] & 0x40);
-  hdr->sbr_flag = !!(data[2] & 0x20);
-  hdr->aac_channel_mode = !!(data[2] & 0x10);
-  hdr->ps_flag = !!(data[2] & 0x08);
-  hdr->mpeg_surround_config = data[2] & 0x07;
+  if (hdr->sbr_flag)
+    *object_type = 1 /*5*/;
+  else
+    *object_type = 1;
 
-  if (hdr->sbr_flag) {
-    if (!hdr->dac_rate) {
-      hdr->num_aus = 2;
-      hdr->au[0].start = 5;
-    } else {
-      hdr->num_aus = 3;
-      hdr->au[0].start = 6;
-    }
+  if (hdr->dac_rate) {
+    *sample_rate = hdr->sbr_flag ? 24000 : 48000;
   } else {
-    if (!hdr->dac_rate) {
-      hdr->num_aus = 4;
-      hdr->au[0].start = 8;
-    } else {
-      hdr->num_aus = 6;
-      hdr->au[0].start = 11;
-    }
-  }
-
-  switch (hdr->num_aus) {
-    case 6:
-      hdr->au[5].start = (data[9] << 4) | (data[10] >> 4);
-      hdr->au[4].start = ((data[7] << 8) & 0xf00) | data[8];
-    case 4:
-      hdr->au[3].start = (data[6] << 4) | (data[7] >> 4);
-    case 3:
-      hdr->au[2].start = ((data[4] << 8) & 0xf00) | data[5];
-    case 2:
-      hdr->au[1].start = (data[3] << 4) | (data[4] >> 4);
-      break;
-    default:
-      return FALSE;
+    *sample_rate = hdr->sbr_flag ? 16000 : 32000;
   }
 
-  for(i = 0; i < hdr->num_aus - 1; ++i)
-    hdr->au[i].size = hdr->au[i + 1].start - hdr->au[i].start - 2;
+  if (hdr->mpeg_surround_config > 0) {
+    switch (hdr->mpeg_surround_config)
+    {
+      case 1:
+        /* MPEG Surround with 5.1 output channels is used */
+        *channels = 6;
+        break;
+      case 2:
+        /* MPEG Surround with 7.1 output channels is used */
+        *channels = 8;
+        break;
+      default:
+        *channels = 0;
+        break;
+    }
+  } else
+    *channels = hdr->aac_channel_mode + 1;
+}
 
-  aus_end = framesize - (framesize / SUPERFRAME_MIN_SIZE) * RS_CODE_SIZE;
-  hdr->au[i].size = aus_end - hdr->au[i].start - 2;
+/**
+ * gst_dabplusparse_get_src_caps_key:
+ * @hdr: #GstDabPlusSuperframeHeader.
+ *
+ * Returns: Index of the audio parameters of @hdr
+ *          (dac rate, sbr, aac channel mode, ps) in the src caps cache,
+ *          -1 if they are not cached (MPEG Surround is used).
+ */
+static gint
+gst_dabplusparse_get_src_caps_key (const GstDabPlusSuperframeHeader * hdr)
+{
+  if (hdr->mpeg_surround_config)
+    return -1;
 
-  return TRUE;
+  return (hdr->dac_rate << 3) | (hdr->sbr_flag << 2) |
+    (hdr->aac_channel_mode << 1) | hdr->ps_flag;
 }
 
 /**
- * gst_dabplusparse_detect_stream:
- * @dabplusparse: #GstDabPlusParse.
- * @data: A block of data that needs to be examined for stream characteristics.
- * @avail: Size of the given datablock.
- * @skipsize: If valid stream was found, this will be set to tell the first
- *            audio frame position within the given data.
- *
- * If the stream is detected, TRUE will be returned and #framesize
- * is set to indicate the found frame size. Additionally, #skipsize might
- * be set to indicate the number of bytes that need to be skipped, a.k.a. the
- * position of the frame inside given data chunk.
+ * gst_dabplusparse_make_src_caps:
+ * @object_type: AAC audio object type.
+ * @sample_rate: AAC core sampling rate.
+ * @channels: Number of channels (0 - unknown).
+ * @header_type: Output stream format.
  *
- * Returns: TRUE on success.
+ * Returns: Newly created src caps or NULL if @sample_rate is not valid.
  */
-static gboolean
-gst_dabplusparse_detect_stream (GstDabPlusParse * dabplusparse,
-    const guint8 * data, const guint avail, gint * skipsize)
+static GstCaps *
+gst_dabplusparse_make_src_caps (gint object_type, gint sample_rate,
+    gint channels, GstDabPlusHeaderType header_type)
 {
-  gboolean found;
-  guint i;
-  guint offsets[2];
-  guint superframe_size;
+  GstStructure *s;
+  GstCaps *caps;
+  guint8 codec_data_table[2];
+  guint16 codec_data;
+  gint sample_rate_idx;
 
-  GST_DEBUG_OBJECT (dabplusparse, "parsing header data (%u bytes)", avail);
+  sample_rate_idx = gst_codec_utils_aac_get_index_from_sample_rate (sample_rate);
+  if (G_UNLIKELY (sample_rate_idx < 0))
+    return NULL;
 
-  if (avail < SUPERFRAME_MAX_SIZE + FIRECODE_LENGTH) {
-    GST_DEBUG_OBJECT (dabplusparse, "not enough data to check");
-    gst_base_parse_set_min_frame_size (
-      GST_BASE_PARSE (dabplusparse), SUPERFRAME_MAX_SIZE + FIRECODE_LENGTH);
-    return FALSE;
-  }
+  caps = gst_caps_new_empty_simple ("audio/mpeg");
+  s = gst_caps_get_structure (caps, 0);
 
-  for (found = FALSE, i = 0; i < avail - FIRECODE_LENGTH; i++) {
-    if (gst_dabplusparse_check_firecode (data + i) == TRUE) {
-      GST_DEBUG_OBJECT (dabplusparse, "found first superframe at offset %u", i);
-      offsets[0] = i;
-      found = TRUE;
-      break;
-    }
-  }
+  gst_structure_set (s, "mpegversion", G_TYPE_INT, MPEGVERSION, NULL);
+  gst_structure_set (s, "framed", G_TYPE_BOOLEAN, TRUE, NULL);
 
-  if (!found)
-    GST_DEBUG_OBJECT (dabplusparse, "cannot find superframe header");
+  /* Generate codec data to be able to set profile/level on the caps */
+  codec_data = (object_type << 11) | (sample_rate_idx << 7) | (channels << 3) |
+    ASC_FRAME_LENGTH_960;
+  GST_WRITE_UINT16_BE (codec_data_table, codec_data);
+  if (!gst_codec_utils_aac_caps_set_level_and_profile (caps,
+    codec_data_table, G_N_ELEMENTS(codec_data_table)))
+      GST_WARNING ("cannot set caps for object_type: %d, sample rate index: %d, channels: %d",
+          object_type, sample_rate_idx, channels);
 
-  if (!found || i) {
-    /* Trick: tell the parent class that we didn't find the frame yet,
-        but make it skip 'i' amount of bytes. Next time we arrive
-        here we have full frame in the beginning of the data. */
-    *skipsize = i;
-    return FALSE;
-  }
+  if (channels > 0)
+    gst_structure_set (s, "channels", G_TYPE_INT, channels, NULL);
 
-  for (found = FALSE, i = SUPERFRAME_MIN_SIZE; i < avail - FIRECODE_LENGTH; i++) {
-    if (gst_dabplusparse_check_firecode (data + i) == TRUE) {
-      GST_DEBUG_OBJECT (dabplusparse, "found second superframe at offset %u", i);
-      offsets[1] = i;
-      found = TRUE;
+  switch (header_type) {
+    case DABPLUS_HEADER_ADTS:
+      gst_structure_set (s, "stream-format", G_TYPE_STRING, "adts", NULL);
       break;
-    }
+    case DABPLUS_HEADER_LOAS:
+      gst_structure_set (s, "stream-format", G_TYPE_STRING, "loas", NULL);
+      break;
+    case DABPLUS_HEADER_RAW: {
+      /* The codec_data data is according to AudioSpecificConfig,
+         ISO/IEC 14496-3, 1.6.2.1 */
+      GstBuffer *codec_data_buffer =
+        gst_buffer_new_and_alloc (G_N_ELEMENTS(codec_data_table));
+      gst_buffer_fill (codec_data_buffer, 0,
+        codec_data_table, G_N_ELEMENTS(codec_data_table));
+      gst_structure_set (s, "stream-format", G_TYPE_STRING, "raw", NULL);
+      gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER,
+          codec_data_buffer, NULL);
+      gst_buffer_unref (codec_data_buffer);
+      break;
+    }
+    case DABPLUS_HEADER_SUPERFRAME:
+      gst_structure_set (s, "stream-format", G_TYPE_STRING, "superframe", NULL);
+      break;
+    default:
+      break;
+  }
+
+  return caps;
+}
+
+/**
+ * gst_dabplusparse_clear_src_caps_cache:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_clear_src_caps_cache (GstDabPlusParse * dabplusparse)
+{
+  guint i;
+
+  for (i = 0; i < DABPLUS_SRC_CAPS_CACHE_SIZE; ++i)
+    gst_caps_replace (&dabplusparse->src_caps_cache[i], NULL);
+
+  dabplusparse->src_caps_cache_type = DABPLUS_HEADER_NOT_PARSED;
+}
+
+/**
+ * gst_dabplusparse_fill_src_caps_cache:
+ * @dabplusparse: #GstDabPlusParse.
+ * @allowed: Caps allowed by downstream.
+ * @cookie: Caps cookie @allowed were queried with.
+ *
+ * Precomputes src caps of all cached audio parameter combinations
+ * in the negotiated output format (o_header_type). Combinations
+ * downstream cannot accept in that format are left out.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_fill_src_caps_cache (GstDabPlusParse * dabplusparse,
+    GstCaps * allowed, guint cookie)
+{
+  GstDabPlusSuperframeHeader hdr;
+  gint object_type, sample_rate, channels;
+  guint i;
+
+  gst_dabplusparse_clear_src_caps_cache (dabplusparse);
+
+  memset (&hdr, 0, sizeof (hdr));
+
+  for (i = 0; i < DABPLUS_SRC_CAPS_CACHE_SIZE; ++i) {
+    GstCaps *caps;
+
+    hdr.dac_rate = (i >> 3) & 1;
+    hdr.sbr_flag = (i >> 2) & 1;
+    hdr.aac_channel_mode = (i >> 1) & 1;
+    hdr.ps_flag = i & 1;
+
+    gst_dabplusparse_get_audio_params (&hdr, &object_type, &sample_rate, &channels);
+    caps = gst_dabplusparse_make_src_caps (object_type, sample_rate, channels,
+      dabplusparse->o_header_type);
+    if (caps && allowed && !gst_caps_can_intersect (caps, allowed))
+      gst_caps_replace (&caps, NULL);
+
+    dabplusparse->src_caps_cache[i] = caps;
+  }
+
+  dabplusparse->src_caps_cache_type = dabplusparse->o_header_type;
+  dabplusparse->src_caps_cache_cookie = cookie;
+
+  GST_DEBUG_OBJECT (dabplusparse, "src caps precomputed");
+}
+
+/**
+ * gst_dabplusparse_set_src_caps:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Set source pad caps according to current knowledge about the
+ * audio stream.
+ * Caps of all (but MPEG Surround) audio parameter combinations are
+ * precomputed once downstream is known, so that parameter switches
+ * only push cached caps. Output format is kept across switches
+ * whenever downstream accepts it.
+ *
+ * Returns: TRUE if caps were successfully set.
+ */
+static gboolean
+gst_dabplusparse_set_src_caps (GstDabPlusParse * dabplusparse)
+{
+  static const GstDabPlusHeaderType formats[] = {
+    DABPLUS_HEADER_ADTS,
+    DABPLUS_HEADER_LOAS,
+    DABPLUS_HEADER_RAW,
+    DABPLUS_HEADER_SUPERFRAME
+  };
+  GstCaps *src_caps = NULL, *allowed;
+  gboolean res = FALSE;
+  gboolean cached;
+  gint sample_rate_idx;
+  guint cookie;
+  gint key;
+  guint i;
+
+  GST_DEBUG_OBJECT (dabplusparse, "setting src caps ...");
+
+  sample_rate_idx =
+      gst_codec_utils_aac_get_index_from_sample_rate (dabplusparse->sample_rate);
+  if (G_UNLIKELY (sample_rate_idx < 0)) {
+    GST_ERROR_OBJECT (dabplusparse, "not a known sample rate: %d",
+      dabplusparse->sample_rate);
+    return FALSE;
+  }
+
+  /* AudioSpecificConfig, as in codec_data of raw caps */
+  dabplusparse->audio_specific_config = (dabplusparse->object_type << 11) |
+    (sample_rate_idx << 7) | (dabplusparse->channels << 3) | ASC_FRAME_LENGTH_960;
+
+  GST_OBJECT_LOCK (dabplusparse);
+  cookie = dabplusparse->caps_cookie;
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  key = gst_dabplusparse_get_src_caps_key (&dabplusparse->superframe_header);
+  cached = (key >= 0) &&
+    (dabplusparse->src_caps_cache_type != DABPLUS_HEADER_NOT_PARSED) &&
+    (dabplusparse->src_caps_cache_cookie == cookie) &&
+    (dabplusparse->src_caps_cache[key] != NULL);
+
+  if (cached) {
+    src_caps = gst_caps_ref (dabplusparse->src_caps_cache[key]);
+    dabplusparse->o_header_type = dabplusparse->src_caps_cache_type;
+    GST_DEBUG_OBJECT (dabplusparse, "using precomputed caps");
+  } else {
+    allowed = gst_pad_get_allowed_caps (GST_BASE_PARSE (dabplusparse)->srcpad);
+    GST_DEBUG_OBJECT (dabplusparse, "allowed caps: %" GST_PTR_FORMAT, allowed);
+
+    dabplusparse->o_header_type = DABPLUS_HEADER_UNKNOWN;
+
+    /* stay with the format negotiated before, if it is still accepted */
+    if (dabplusparse->src_caps_cache_type != DABPLUS_HEADER_NOT_PARSED) {
+      src_caps = gst_dabplusparse_make_src_caps (dabplusparse->object_type,
+        dabplusparse->sample_rate, dabplusparse->channels,
+        dabplusparse->src_caps_cache_type);
+      if (gst_caps_can_intersect (src_caps, allowed))
+        dabplusparse->o_header_type = dabplusparse->src_caps_cache_type;
+      else
+        gst_caps_replace (&src_caps, NULL);
+    }
+
+    /* otherwise adts is tried first, then loas, raw and superframe */
+    for (i = 0; (i < G_N_ELEMENTS (formats)) && !src_caps; ++i) {
+      src_caps = gst_dabplusparse_make_src_caps (dabplusparse->object_type,
+        dabplusparse->sample_rate, dabplusparse->channels,
+        formats[i]);
+      if (gst_caps_can_intersect (src_caps, allowed)) {
+        dabplusparse->o_header_type = formats[i];
+        break;
+      }
+
+      GST_INFO_OBJECT (GST_BASE_PARSE (dabplusparse)->srcpad,
+        "caps %" GST_PTR_FORMAT " can not intersect", src_caps);
+      gst_caps_replace (&src_caps, NULL);
+    }
+
+    if (!src_caps) {
+      GST_INFO_OBJECT (GST_BASE_PARSE (dabplusparse)->srcpad,
+        "Caps can not intersect, giving up");
+      src_caps = gst_dabplusparse_make_src_caps (dabplusparse->object_type,
+        dabplusparse->sample_rate, dabplusparse->channels,
+        DABPLUS_HEADER_UNKNOWN);
+    } else
+      gst_dabplusparse_fill_src_caps_cache (dabplusparse, allowed, cookie);
+
+    if (allowed)
+      gst_caps_unref (allowed);
+  }
+
+  GST_DEBUG_OBJECT (dabplusparse, "src caps: %" GST_PTR_FORMAT, src_caps);
+
+  if (dabplusparse->o_header_type == DABPLUS_HEADER_ADTS)
+    gst_dabplusparse_set_adts_header_template (dabplusparse, src_caps);
+
+  res = gst_pad_set_caps (GST_BASE_PARSE (dabplusparse)->srcpad, src_caps);
+  /* the pool only depends on the output format */
+  if (res && !(cached && dabplusparse->pool))
+    gst_dabplusparse_decide_allocation (dabplusparse, src_caps);
+  gst_caps_unref (src_caps);
+  return res;
+}
+
+/**
+ * gst_dabplusparse_superframe_header_compare_audio_params:
+ * @hdr1: #GstDabPlusSuperframeHeader.
+ * @hdr2: #GstDabPlusSuperframeHeader.
+ *
+ * Resets 'dabplusparse' instance to its defaut state.
+ *
+ * Returns: TRUE if audio params are the same, FALSE otherwise.
+ */
+static gboolean
+gst_dabplusparse_superframe_header_compare_audio_params(
+  const GstDabPlusSuperframeHeader *hdr1,
+  const GstDabPlusSuperframeHeader *hdr2)
+{
+  return (hdr1->dac_rate             == hdr2->dac_rate) &&
+         (hdr1->sbr_flag             == hdr2->sbr_flag) &&
+         (hdr1->aac_channel_mode     == hdr2->aac_channel_mode) &&
+         (hdr1->ps_flag              == hdr2->ps_flag) &&
+         (hdr1->mpeg_surround_config == hdr2->mpeg_surround_config);
+}
+
+/* caller ensure sufficient data */
+static inline gboolean
+gst_dabplusparse_parse_superframe_header (GstDabPlusSuperframeHeader *hdr,
+  const guint8 *data, guint framesize)
+{
+  guint i;
+  guint aus_end;
+
+  hdr->header_firecode = (data[0] << 8) | (data[1] << 0);
+  hdr->rfa = !!(data[2] & 0x80);
+  hdr->dac_rate = !!(data[2] & 0x40);
+  hdr->sbr_flag = !!(data[2] & 0x20);
+  hdr->aac_channel_mode = !!(data[2] & 0x10);
+  hdr->ps_flag = !!(data[2] & 0x08);
+  hdr->mpeg_surround_config = data[2] & 0x07;
+
+  if (hdr->sbr_flag) {
+    if (!hdr->dac_rate) {
+      hdr->num_aus = 2;
+      hdr->au[0].start = 5;
+    } else {
+      hdr->num_aus = 3;
+      hdr->au[0].start = 6;
+    }
+  } else {
+    if (!hdr->dac_rate) {
+      hdr->num_aus = 4;
+      hdr->au[0].start = 8;
+    } else {
+      hdr->num_aus = 6;
+      hdr->au[0].start = 11;
+    }
+  }
+
+  switch (hdr->num_aus) {
+    case 6:
+      hdr->au[5].start = (data[9] << 4) | (data[10] >> 4);
+      hdr->au[4].start = ((data[7] << 8) & 0xf00) | data[8];
+    case 4:
+      hdr->au[3].start = (data[6] << 4) | (data[7] >> 4);
+    case 3:
+      hdr->au[2].start = ((data[4] << 8) & 0xf00) | data[5];
+    case 2:
+      hdr->au[1].start = (data[3] << 4) | (data[4] >> 4);
+      break;
+    default:
+      return FALSE;
+  }
+
+  aus_end = framesize - (framesize / SUPERFRAME_MIN_SIZE) * RS_CODE_SIZE;
+
+  /* Reject implausible AU layouts: every AU has to hold at least its CRC
+     and all of them have to fit within the audio part of the superframe */
+  for(i = 1; i < hdr->num_aus; ++i)
+    if (hdr->au[i].start < hdr->au[i - 1].start + 2)
+      return FALSE;
+  if (hdr->au[hdr->num_aus - 1].start + 2 > aus_end)
+    return FALSE;
+
+  for(i = 0; i < hdr->num_aus - 1; ++i)
+    hdr->au[i].size = hdr->au[i + 1].start - hdr->au[i].start - 2;
+
+  hdr->au[i].size = aus_end - hdr->au[i].start - 2;
+
+  for(i = 0; i < hdr->num_aus; ++i)
+    hdr->au[i].crc_ok = TRUE;
+
+  return TRUE;
+}
+
+/**
+ * gst_dabplusparse_check_au_crcs:
+ * @hdr: Parsed superframe header, crc_ok of its access units gets updated.
+ * @data: Superframe data.
+ *
+ * Verifies CRC-16 CCITT which follows every access unit.
+ *
+ * Returns: Number of access units with invalid CRC.
+ */
+static guint
+gst_dabplusparse_check_au_crcs (GstDabPlusSuperframeHeader * hdr,
+    const guint8 * data)
+{
+  guint n_errors = 0;
+  guint i;
+
+  for (i = 0; i < hdr->num_aus; ++i) {
+    const guint8 *au = data + hdr->au[i].start;
+    guint16 crc = (au[hdr->au[i].size] << 8) | au[hdr->au[i].size + 1];
+
+    hdr->au[i].crc_ok = (gst_dabplus_crc_ccitt (au, hdr->au[i].size) == crc);
+    if (!hdr->au[i].crc_ok)
+      ++n_errors;
+  }
+
+  return n_errors;
+}
+
+/**
+ * gst_dabplusparse_score_superframe_size:
+ * @data: A block of data that is examined.
+ * @avail: Size of the given datablock.
+ * @hits: Offsets holding valid firecode, in increasing order.
+ * @n_hits: Number of @hits.
+ * @superframe_size: Superframe size to be scored.
+ * @start: Set to the offset of the first superframe which is followed
+ *         by another one @superframe_size bytes further.
+ * @candidates: Set to the number of plausible superframe headers which
+ *              could have been followed by another one within @avail.
+ *
+ * Returns: Number of plausible superframe headers followed by another one
+ *          exactly @superframe_size bytes further.
+ */
+static guint
+gst_dabplusparse_score_superframe_size (const guint8 * data, guint avail,
+    const guint * hits, guint n_hits, guint superframe_size,
+    guint * start, guint * candidates)
+{
+  GstDabPlusSuperframeHeader hdr;
+  guint score = 0;
+  guint i, j;
+
+  *candidates = 0;
+
+  for (i = 0, j = 0; i < n_hits; ++i) {
+    if (hits[i] + superframe_size + FIRECODE_LENGTH > avail)
+      break;
+
+    if (!gst_dabplusparse_parse_superframe_header (&hdr, data + hits[i], superframe_size))
+      continue;
+
+    ++*candidates;
+
+    while ((j < n_hits) && (hits[j] < hits[i] + superframe_size))
+      ++j;
+
+    if ((j < n_hits) && (hits[j] == hits[i] + superframe_size)) {
+      if (score++ == 0)
+        *start = hits[i];
+    }
+  }
+
+  return score;
+}
+
+/**
+ * gst_dabplusparse_detect_stream:
+ * @dabplusparse: #GstDabPlusParse.
+ * @data: A block of data that needs to be examined for stream characteristics.
+ * @avail: Size of the given datablock.
+ * @skipsize: Set to the number of bytes which need to be skipped, a.k.a. the
+ *            position of the first superframe inside given data chunk.
+ *
+ * If the stream is detected, TRUE will be returned and
+ * dabplusparse->superframe_size is set to indicate the found frame size.
+ * Additionally, #skipsize might be set to indicate the number of bytes that
+ * need to be skipped to get to the first superframe.
+ *
+ * All firecode hits within the data are collected and every superframe size
+ * suggested by the distance of two of them gets scored by the number of
+ * plausible headers followed by another header exactly that far.
+ * The best scored size wins (the smaller one on a tie, as multiples of the
+ * real size score as well), so random firecode matches inside audio payload
+ * do not cause false locks. The ratio of consistent headers is reported
+ * as confidence.
+ *
+ * Detection is incremental. If there is no candidate within the data
+ * we have got so far, the detection window is doubled (2 x 120, 2 x 240, ...)
+ * up to SUPERFRAME_MAX_SIZE, so low bitrate subchannels get locked
+ * without waiting for a maximum sized superframe worth of data.
+ *
+ * Returns: TRUE on success.
+ */
+static gboolean
+gst_dabplusparse_detect_stream (GstDabPlusParse * dabplusparse,
+    const guint8 * data, const guint avail, gint * skipsize)
+{
+  GstDabPlusSuperframeHeader hdr;
+  guint hits[DETECT_MAX_HITS];
+  guint8 scored[N_MAX + 1];
+  guint n_hits;
+  guint i, j;
+  guint superframe_size;
+  guint best_size, best_score, best_start, best_candidates;
+
+  GST_DEBUG_OBJECT (dabplusparse, "parsing header data (%u bytes)", avail);
+
+  if (avail < FIRECODE_LENGTH) {
+    GST_DEBUG_OBJECT (dabplusparse, "not enough data to check");
+    return FALSE;
+  }
+
+  for (n_hits = 0, i = 0; n_hits < DETECT_MAX_HITS; ++n_hits, ++i) {
+    if (!gst_dabplus_crc_find_firecode (data, i, avail - FIRECODE_LENGTH + 1, &i))
+      break;
+    hits[n_hits] = i;
+  }
+
+  GST_DEBUG_OBJECT (dabplusparse, "found %u firecode hits", n_hits);
+
+  if (n_hits == 0) {
+    /* Tell the parent class to skip everything but
+       the tail which might hold beginning of a superframe. */
+    *skipsize = avail - FIRECODE_LENGTH + 1;
+    return FALSE;
+  }
+
+  superframe_size = gst_dabplusparse_get_known_superframe_size (dabplusparse);
+  if (superframe_size) {
+    for (i = 0; i < n_hits; ++i)
+      if (gst_dabplusparse_parse_superframe_header (&hdr, data + hits[i], superframe_size))
+        break;
+
+    if (i == n_hits) {
+      GST_DEBUG_OBJECT (dabplusparse, "no plausible superframe header");
+      *skipsize = hits[n_hits - 1] + 1;
+      return FALSE;
+    }
+
+    GST_INFO_OBJECT (dabplusparse, "superframe size: %u (%u x %u), known in advance",
+      superframe_size, superframe_size / SUPERFRAME_MIN_SIZE, SUPERFRAME_MIN_SIZE);
+
+    dabplusparse->superframe_size = superframe_size;
+    GST_OBJECT_LOCK (dabplusparse);
+    dabplusparse->sync_confidence = 100;
+    GST_OBJECT_UNLOCK (dabplusparse);
+    gst_base_parse_set_min_frame_size (GST_BASE_PARSE (dabplusparse), superframe_size);
+    *skipsize = hits[i];
+    return TRUE;
+  }
+
+  memset (scored, 0, sizeof (scored));
+  best_size = best_score = best_start = best_candidates = 0;
+
+  for (i = 0; i < n_hits; ++i) {
+    for (j = i + 1; j < n_hits; ++j) {
+      guint score, start, candidates;
+
+      superframe_size = hits[j] - hits[i];
+      if (superframe_size > SUPERFRAME_MAX_SIZE)
+        break;
+
+      if ((superframe_size % SUPERFRAME_MIN_SIZE) ||
+          scored[superframe_size / SUPERFRAME_MIN_SIZE])
+        continue;
+
+      scored[superframe_size / SUPERFRAME_MIN_SIZE] = 1;
+
+      score = gst_dabplusparse_score_superframe_size (data, avail,
+        hits, n_hits, superframe_size, &start, &candidates);
+
+      GST_LOG_OBJECT (dabplusparse, "superframe size %u: score %u of %u",
+        superframe_size, score, candidates);
+
+      if ((score > best_score) ||
+          ((score == best_score) && (score > 0) && (superframe_size < best_size))) {
+        best_size = superframe_size;
+        best_score = score;
+        best_start = start;
+        best_candidates = candidates;
+      }
+    }
+  }
+
+  if (best_score == 0) {
+    if (hits[0] > 0) {
+      /* Trick: tell the parent class that we didn't find the frame yet,
+          but make it skip up to the first candidate. Next time we arrive
+          here we have potential superframe in the beginning of the data. */
+      *skipsize = hits[0];
+    } else if (avail - FIRECODE_LENGTH >= SUPERFRAME_MAX_SIZE) {
+      GST_DEBUG_OBJECT (dabplusparse,
+        "no superframe following within %u bytes, dropping first one", SUPERFRAME_MAX_SIZE);
+      dabplusparse->detect_window = 2 * SUPERFRAME_MIN_SIZE;
+      *skipsize = 1;
+    } else {
+      dabplusparse->detect_window = MIN (SUPERFRAME_MAX_SIZE,
+        2 * MAX (avail - FIRECODE_LENGTH, SUPERFRAME_MIN_SIZE));
+      GST_DEBUG_OBJECT (dabplusparse,
+        "no superframe size candidate yet, growing detection window to %u bytes",
+        dabplusparse->detect_window);
+    }
+
+    gst_base_parse_set_min_frame_size (GST_BASE_PARSE (dabplusparse),
+      dabplusparse->detect_window + FIRECODE_LENGTH);
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (dabplusparse, "superframe size: %u (%u x %u), confidence %u%% (%u of %u)",
+    best_size, best_size / SUPERFRAME_MIN_SIZE, SUPERFRAME_MIN_SIZE,
+    100 * best_score / best_candidates, best_score, best_candidates);
+
+  dabplusparse->superframe_size = best_size;
+  GST_OBJECT_LOCK (dabplusparse);
+  dabplusparse->sync_confidence = 100 * best_score / best_candidates;
+  GST_OBJECT_UNLOCK (dabplusparse);
+  dabplusparse->detect_window = 2 * SUPERFRAME_MIN_SIZE;
+
+  gst_base_parse_set_min_frame_size (GST_BASE_PARSE (dabplusparse), best_size);
+
+  *skipsize = best_start;
+  return TRUE;
+}
+
+/**
+ * gst_dabplusparse_keep_lookbehind:
+ * @dabplusparse: #GstDabPlusParse.
+ * @offset: Byte offset of the superframe.
+ * @data: Superframe data (superframe_size bytes) about to be consumed.
+ *
+ * Keeps the last bytes of the superframe for gst_dabplusparse_resync().
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_keep_lookbehind (GstDabPlusParse * dabplusparse,
+    guint64 offset, const guint8 * data)
+{
+  memcpy (dabplusparse->lookbehind,
+    data + dabplusparse->superframe_size - DABPLUS_RESYNC_PROBE_RANGE,
+    DABPLUS_RESYNC_PROBE_RANGE);
+  dabplusparse->lookbehind_offset = offset + dabplusparse->superframe_size;
+}
+
+/**
+ * gst_dabplusparse_resync:
+ * @dabplusparse: #GstDabPlusParse.
+ * @offset: Byte offset of @data.
+ * @data: A block of data which was expected to start with a superframe.
+ * @avail: Size of the given datablock.
+ * @skipsize: Set to the number of bytes which need to be skipped.
+ *
+ * Called when there is no valid superframe where we expected one.
+ * As long as the number of consecutive misses doesn't exceed
+ * "max-sync-misses", the superframe size and audio parameters are kept
+ * (flywheel): offsets up to DABPLUS_RESYNC_PROBE_RANGE bytes around
+ * the expected one are probed for the superframe header first and,
+ * if there is none, the whole superframe is skipped.
+ * Headers before the expected offset (input bytes got lost) are looked for
+ * in the kept end of the previous superframe. That superframe has already
+ * been partly consumed and is skipped, but sync is kept on the next one.
+ * Otherwise full detection is started from scratch.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_resync (GstDabPlusParse * dabplusparse, guint64 offset,
+    const guint8 * data, guint avail, gint * skipsize)
+{
+  guint8 window[DABPLUS_RESYNC_PROBE_RANGE + FIRECODE_LENGTH];
+  gboolean behind;
+  guint max_sync_misses;
+  guint i;
+
+  GST_OBJECT_LOCK (dabplusparse);
+  max_sync_misses = dabplusparse->max_sync_misses;
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  if (++dabplusparse->sync_misses > max_sync_misses) {
+    GST_INFO_OBJECT (dabplusparse,
+      "%u consecutive superframes missed, starting full resynchronisation",
+      dabplusparse->sync_misses);
+    gst_dabplusparse_reset (dabplusparse);
+    return;
+  }
+
+  behind = (dabplusparse->lookbehind_offset == offset) && (avail >= FIRECODE_LENGTH);
+  if (behind) {
+    memcpy (window, dabplusparse->lookbehind, DABPLUS_RESYNC_PROBE_RANGE);
+    memcpy (window + DABPLUS_RESYNC_PROBE_RANGE, data, FIRECODE_LENGTH);
+  }
+
+  for (i = 1; i <= DABPLUS_RESYNC_PROBE_RANGE; ++i) {
+    if ((i + FIRECODE_LENGTH <= avail) && gst_dabplus_crc_check_firecode (data + i)) {
+      GST_INFO_OBJECT (dabplusparse, "superframe found %u bytes further", i);
+      *skipsize = i;
+      return;
+    }
+
+    if (behind && gst_dabplus_crc_check_firecode (window + DABPLUS_RESYNC_PROBE_RANGE - i)) {
+      GST_INFO_OBJECT (dabplusparse, "superframe found %u bytes earlier, skipping it", i);
+      *skipsize = dabplusparse->superframe_size - i;
+      return;
+    }
+  }
+
+  GST_INFO_OBJECT (dabplusparse, "skipping superframe (miss %u of %u)",
+    dabplusparse->sync_misses, max_sync_misses);
+  *skipsize = dabplusparse->superframe_size;
+
+  if (avail >= dabplusparse->superframe_size)
+    gst_dabplusparse_keep_lookbehind (dabplusparse, offset, data);
+}
+
+/**
+ * gst_dabplusparse_get_audio_profile_object_type
+ * @caps: src pad caps.
+ *
+ * Gets the MPEG-2 profile or the MPEG-4 object type value corresponding to the
+ * mpegversion and profile of @caps, according to the
+ * values defined by table 1.A.11 in ISO/IEC 14496-3.
+ *
+ * Returns: the profile or object type value corresponding to @caps,
+ * if such a value exists; otherwise G_MAXUINT8.
+ */
+static guint8
+gst_dabplusparse_get_audio_profile_object_type (GstCaps * caps)
+{
+  GstStructure *srcstruct;
+  const gchar *profile;
+  guint8 ret;
+
+  srcstruct = gst_caps_get_structure (caps, 0);
+  profile = gst_structure_get_string (srcstruct, "profile");
+  if (G_UNLIKELY (profile == NULL))
+    return G_MAXUINT8;
+
+  if (g_strcmp0 (profile, "main") == 0) {
+    ret = (guint8) 0U;
+  } else if (g_strcmp0 (profile, "lc") == 0) {
+    ret = (guint8) 1U;
+  } else if (g_strcmp0 (profile, "ssr") == 0) {
+    ret = (guint8) 2U;
+  } else if (g_strcmp0 (profile, "ltp") == 0) {
+    ret = (guint8) 3U;
+  } else {
+    ret = G_MAXUINT8;
+  }
+
+  return ret;
+}
+
+/**
+ * gst_dabplusparse_get_audio_channel_configuration
+ * @num_channels: number of audio channels.
+ *
+ * Gets the Channel Configuration value, as defined by table 1.19 in ISO/IEC
+ * 14496-3, for a given number of audio channels.
+ *
+ * Returns: the Channel Configuration value corresponding to @num_channels, if
+ * such a value exists; otherwise G_MAXUINT8.
+ */
+static guint8
+gst_dabplusparse_get_audio_channel_configuration (gint num_channels)
+{
+  if (num_channels >= 1 && num_channels <= 6)   /* Mono up to & including 5.1 */
+    return (guint8) num_channels;
+  else if (num_channels == 8)   /* 7.1 */
+    return (guint8) 7U;
+  else
+    return G_MAXUINT8;
+}
+
+/**
+ * gst_dabplusparse_get_audio_sampling_frequency_index:
+ * @sample_rate: audio sampling rate.
+ *
+ * Gets the Sampling Frequency Index value, as defined by table 1.18 in ISO/IEC
+ * 14496-3, for a given sampling rate.
+ *
+ * Returns: the Sampling Frequency Index value corresponding to @sample_rate,
+ * if such a value exists; otherwise G_MAXUINT8.
+ */
+static guint8
+gst_dabplusparse_get_audio_sampling_frequency_index (gint sample_rate)
+{
+  switch (sample_rate) {
+    case 96000:
+      return 0x0U;
+    case 88200:
+      return 0x1U;
+    case 64000:
+      return 0x2U;
+    case 48000:
+      return 0x3U;
+    case 44100:
+      return 0x4U;
+    case 32000:
+      return 0x5U;
+    case 24000:
+      return 0x6U;
+    case 22050:
+      return 0x7U;
+    case 16000:
+      return 0x8U;
+    case 12000:
+      return 0x9U;
+    case 11025:
+      return 0xAU;
+    case 8000:
+      return 0xBU;
+    case 7350:
+      return 0xCU;
+    default:
+      return G_MAXUINT8;
+  }
+}
+
+/**
+ * gst_dabplusparse_set_adts_header_template:
+ * @dabplusparse: #GstDabPlusParse.
+ * @caps: src pad caps about to be set.
+ *
+ * Computes fixed part of ADTS headers (everything but the frame length)
+ * for the audio parameters described by @caps. This is done once per
+ * caps negotiation so that access units only have their length patched in.
+ *
+ * Returns: TRUE if ADTS headers can be generated for @caps; FALSE otherwise.
+ */
+static gboolean
+gst_dabplusparse_set_adts_header_template (GstDabPlusParse * dabplusparse,
+    GstCaps * caps)
+{
+  guint8 *adts_header = dabplusparse->adts_header;
+  guint8 id, profile, channel_configuration, sampling_frequency_index;
+
+  dabplusparse->adts_header_valid = FALSE;
+
+  id = 0x0U; /* MPEG4 */
+  profile = gst_dabplusparse_get_audio_profile_object_type (caps);
+  if (profile == G_MAXUINT8) {
+    GST_ERROR_OBJECT (dabplusparse, "unsupported audio profile or object type");
+    return FALSE;
+  }
+  channel_configuration =
+      gst_dabplusparse_get_audio_channel_configuration (dabplusparse->channels);
+  if (channel_configuration == G_MAXUINT8) {
+    GST_ERROR_OBJECT (dabplusparse, "unsupported number of channels");
+    return FALSE;
+  }
+  sampling_frequency_index =
+      gst_dabplusparse_get_audio_sampling_frequency_index (dabplusparse->sample_rate);
+  if (sampling_frequency_index == G_MAXUINT8) {
+    GST_ERROR_OBJECT (dabplusparse, "unsupported sampling frequency");
+    return FALSE;
+  }
+
+  /* Note: no error correction bits are added to the resulting ADTS frames */
+  adts_header[0] = 0xFFU;
+  adts_header[1] = 0xF0U | (id << 3) | 0x1U;
+  adts_header[2] = (profile << 6) | (sampling_frequency_index << 2) | 0x2U |
+      (channel_configuration & 0x4U);
+  adts_header[3] = ((channel_configuration & 0x3U) << 6) | 0x30U;
+  adts_header[4] = 0x00U;
+  adts_header[5] = 0x1FU;
+  adts_header[6] = 0xFCU;
+
+  dabplusparse->adts_header_valid = TRUE;
+  return TRUE;
+}
+
+/**
+ * gst_dabplusparse_write_adts_header:
+ * @dabplusparse: #GstDabPlusParse.
+ * @buffer: Output buffer whose first ADTS_HEADER_LENGTH bytes receive the header.
+ * @au_size: Size of the raw AAC frame which will follow the header.
+ *
+ * Writes ADTS header for a raw AAC audio frame of @au_size bytes.
+ *
+ * Returns: TRUE if ADTS header was successfully written; FALSE otherwise.
+ */
+static gboolean
+gst_dabplusparse_write_adts_header (GstDabPlusParse * dabplusparse,
+    GstBuffer * buffer, gsize au_size)
+{
+  guint8 adts_header[ADTS_HEADER_LENGTH];
+  gsize frame_size;
+
+  if (G_UNLIKELY (!dabplusparse->adts_header_valid)) {
+    GST_ERROR_OBJECT (dabplusparse, "no adts header for negotiated caps");
+    return FALSE;
+  }
+
+  frame_size = au_size + ADTS_HEADER_LENGTH;
+
+  if (G_UNLIKELY (frame_size >= 0x4000)) {
+    GST_ERROR_OBJECT (dabplusparse, "frame size is too big for adts");
+    return FALSE;
+  }
+
+  memcpy (adts_header, dabplusparse->adts_header, ADTS_HEADER_LENGTH);
+  adts_header[3] |= (guint8) (frame_size >> 11);
+  adts_header[4] = (guint8) ((frame_size >> 3) & 0x00FF);
+  adts_header[5] |= (guint8) ((frame_size & 0x0007) << 5);
+
+  return gst_buffer_fill (buffer, 0, adts_header, ADTS_HEADER_LENGTH) ==
+    ADTS_HEADER_LENGTH;
+}
+
+static void
+gst_dabplusparse_remove_fields (GstCaps * caps)
+{
+  guint i, n;
+
+  n = gst_caps_get_size (caps);
+  for (i = 0; i < n; i++) {
+    GstStructure *s = gst_caps_get_structure (caps, i);
+
+    gst_structure_remove_field (s, "framed");
+  }
+}
+
+static void
+gst_dabplusparse_add_conversion_fields (GstCaps * caps)
+{
+  guint i, n;
+
+  n = gst_caps_get_size (caps);
+  for (i = 0; i < n; i++) {
+    GstStructure *s = gst_caps_get_structure (caps, i);
+
+    if (gst_structure_has_field (s, "stream-format")) {
+      const GValue *v = gst_structure_get_value (s, "stream-format");
+
+      if (G_VALUE_HOLDS_STRING (v)) {
+        const gchar *str = g_value_get_string (v);
+
+        if (strcmp (str, "adts") == 0 || strcmp (str, "raw") == 0 ||
+            strcmp (str, "loas") == 0) {
+          GValue va = G_VALUE_INIT;
+          GValue vs = G_VALUE_INIT;
+
+          g_value_init (&va, GST_TYPE_LIST);
+          g_value_init (&vs, G_TYPE_STRING);
+          g_value_set_string (&vs, "adts");
+          gst_value_list_append_value (&va, &vs);
+          g_value_set_string (&vs, "raw");
+          gst_value_list_append_value (&va, &vs);
+          g_value_set_string (&vs, "loas");
+          gst_value_list_append_value (&va, &vs);
+          gst_structure_set_value (s, "stream-format", &va);
+          g_value_unset (&va);
+          g_value_unset (&vs);
+        }
+      } else if (GST_VALUE_HOLDS_LIST (v)) {
+        gboolean contains_raw = FALSE;
+        gboolean contains_adts = FALSE;
+        gboolean contains_loas = FALSE;
+        guint m = gst_value_list_get_size (v), j;
+
+        for (j = 0; j < m; j++) {
+          const GValue *ve = gst_value_list_get_value (v, j);
+          const gchar *str;
+
+          if (G_VALUE_HOLDS_STRING (ve) && (str = g_value_get_string (ve))) {
+            if (strcmp (str, "adts") == 0)
+              contains_adts = TRUE;
+            else if (strcmp (str, "raw") == 0)
+              contains_raw = TRUE;
+            else if (strcmp (str, "loas") == 0)
+              contains_loas = TRUE;
+          }
+        }
+
+        if (contains_adts || contains_raw || contains_loas) {
+          GValue va = G_VALUE_INIT;
+          GValue vs = G_VALUE_INIT;
+
+          g_value_init (&va, GST_TYPE_LIST);
+          g_value_init (&vs, G_TYPE_STRING);
+          g_value_copy (v, &va);
+
+          if (!contains_raw) {
+            g_value_set_string (&vs, "raw");
+            gst_value_list_append_value (&va, &vs);
+          }
+          if (!contains_adts) {
+            g_value_set_string (&vs, "adts");
+            gst_value_list_append_value (&va, &vs);
+          }
+          if (!contains_loas) {
+            g_value_set_string (&vs, "loas");
+            gst_value_list_append_value (&va, &vs);
+          }
+
+          gst_structure_set_value (s, "stream-format", &va);
+
+          g_value_unset (&vs);
+          g_value_unset (&va);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * gst_dabplusparse_open_index:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Maps the index given by "index-location", provided it was built from
+ * a recording of the size upstream reports. If there is no such index there,
+ * a new one is written while the recording is parsed. Called with the first
+ * data, as upstream may not know its size before it is started.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_open_index (GstDabPlusParse * dabplusparse)
+{
+  GstDabPlusIndex *index;
+  gchar *location;
+  gint64 bytes;
+
+  GST_OBJECT_LOCK (dabplusparse);
+  location = g_strdup (dabplusparse->index_location);
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  if (!location)
+    return;
+
+  if (!gst_pad_peer_query_duration (GST_BASE_PARSE_SINK_PAD (dabplusparse),
+      GST_FORMAT_BYTES, &bytes) || (bytes <= 0)) {
+    GST_INFO_OBJECT (dabplusparse, "upstream size unknown, "
+      "not using index '%s'", location);
+    g_free (location);
+    return;
+  }
+
+  index = gst_dabplus_index_open (location);
+  if (index && (gst_dabplus_index_get_recording_size (index) != (guint64) bytes)) {
+    GST_INFO_OBJECT (dabplusparse, "index '%s' is for %" G_GUINT64_FORMAT
+      " bytes, recording has %" G_GINT64_FORMAT, location,
+      gst_dabplus_index_get_recording_size (index), bytes);
+    gst_dabplus_index_unref (index);
+    index = NULL;
+  }
+
+  if (index) {
+    GST_INFO_OBJECT (dabplusparse, "using index '%s' (%u superframes)",
+      location, gst_dabplus_index_get_n_entries (index));
+    GST_OBJECT_LOCK (dabplusparse);
+    dabplusparse->index = index;
+    GST_OBJECT_UNLOCK (dabplusparse);
+  } else {
+    GST_INFO_OBJECT (dabplusparse, "no valid index '%s', writing one", location);
+    dabplusparse->index_writing = TRUE;
+  }
+
+  g_free (location);
+}
+
+/**
+ * gst_dabplusparse_close_index:
+ * @dabplusparse: #GstDabPlusParse.
+ * @complete: Whether the whole recording has been indexed.
+ *
+ * Frees the index. The index being written is kept only if @complete is set,
+ * otherwise it is removed.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_close_index (GstDabPlusParse * dabplusparse,
+    gboolean complete)
+{
+  GstDabPlusIndex *index;
+  gint64 bytes = 0;
+
+  if (dabplusparse->index_writer) {
+    if (complete && (!gst_pad_peer_query_duration (
+        GST_BASE_PARSE_SINK_PAD (dabplusparse), GST_FORMAT_BYTES, &bytes) ||
+        (bytes <= 0))) {
+      GST_INFO_OBJECT (dabplusparse, "upstream size unknown");
+      complete = FALSE;
+    }
+
+    if (!complete) {
+      GST_INFO_OBJECT (dabplusparse, "recording not indexed completely, "
+        "removing index");
+      gst_dabplus_index_writer_abort (dabplusparse->index_writer);
+    } else if (!gst_dabplus_index_writer_finish (dabplusparse->index_writer, bytes))
+      GST_WARNING_OBJECT (dabplusparse, "failed to write index");
+    dabplusparse->index_writer = NULL;
+  }
+
+  dabplusparse->index_writing = FALSE;
+  dabplusparse->index_pending = FALSE;
+
+  /* convert() may still hold a reference */
+  GST_OBJECT_LOCK (dabplusparse);
+  index = dabplusparse->index;
+  dabplusparse->index = NULL;
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  if (index)
+    gst_dabplus_index_unref (index);
+}
+
+/**
+ * gst_dabplusparse_start:
+ * @baseparse: #GstBaseParse.
+ *
+ * Implementation of "start" vmethod in #GstBaseParse class.
+ *
+ * Returns: TRUE if startup succeeded.
+ */
+static gboolean
+gst_dabplusparse_start (GstBaseParse * baseparse)
+{
+  GstDabPlusParse *dabplusparse;
+  gboolean parallel;
+  guint pipeline_depth;
+
+  dabplusparse = GST_DABPLUSPARSE (baseparse);
+
+  GST_INFO_OBJECT (dabplusparse, "starting");
+
+  gst_dabplusparse_reset (dabplusparse);
+  gst_dabplusparse_clear_sink_caps_cache (dabplusparse);
+  dabplusparse->index_pending = TRUE;
+
+  GST_OBJECT_LOCK (dabplusparse);
+  parallel = dabplusparse->parallel;
+  pipeline_depth = dabplusparse->pipeline_depth;
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  if (parallel) {
+    dabplusparse->workers = g_thread_pool_new (gst_dabplusparse_check_job,
+      dabplusparse, g_get_num_processors (), FALSE, NULL);
+    GST_INFO_OBJECT (dabplusparse, "checking superframes on %u threads",
+      g_get_num_processors ());
+  }
+
+  if (pipeline_depth > 0)
+    gst_dabplusparse_emit_start (dabplusparse, pipeline_depth);
+
+  return TRUE;
+}
+
+/**
+ * gst_dabplusparse_stop:
+ * @baseparse: #GstBaseParse.
+ *
+ * Implementation of "stop" vmethod in #GstBaseParse class.
+ *
+ * Returns: TRUE if stopping succeeded.
+ */
+static gboolean
+gst_dabplusparse_stop (GstBaseParse * baseparse)
+{
+  GstDabPlusParse *dabplusparse;
+
+  dabplusparse = GST_DABPLUSPARSE (baseparse);
+
+  GST_INFO_OBJECT (dabplusparse, "stopping");
+
+  gst_dabplusparse_emit_stop (dabplusparse);
+  gst_dabplusparse_release_pool (dabplusparse);
+  gst_dabplusparse_clear_src_caps_cache (dabplusparse);
+  gst_dabplusparse_clear_sink_caps_cache (dabplusparse);
+  gst_dabplusparse_close_index (dabplusparse, FALSE);
+
+  if (dabplusparse->workers) {
+    g_thread_pool_free (dabplusparse->workers, FALSE, TRUE);
+    dabplusparse->workers = NULL;
+  }
+
+  return TRUE;
+}
+
+/**
+ * gst_dabplusparse_set_sink_caps:
+ * @baseparse: #GstBaseParse.
+ * @caps: #GstCaps
+ *
+ * Implementation of "set_sink_caps" vmethod in #GstBaseParse class.
+ * Picks up superframe size announced by upstream
+ * (either as "superframe-size" in bytes or "bitrate" in kbit/s).
+ *
+ * Returns: TRUE if caps were accepted.
+ */
+static gboolean
+gst_dabplusparse_set_sink_caps (GstBaseParse * baseparse, GstCaps * caps)
+{
+  GstDabPlusParse *dabplusparse;
+  GstStructure *s;
+  gint value;
+  guint superframe_size = 0;
+
+  dabplusparse = GST_DABPLUSPARSE (baseparse);
+
+  GST_INFO_OBJECT (dabplusparse, "sink caps: %" GST_PTR_FORMAT, caps);
+
+  s = gst_caps_get_structure (caps, 0);
+
+  if (gst_structure_get_int (s, "superframe-size", &value))
+    superframe_size = value;
+  else if (gst_structure_get_int (s, "bitrate", &value)) {
+    if ((value <= 0) || (value % BITRATE_STEP))
+      GST_WARNING_OBJECT (dabplusparse, "invalid bitrate %d in caps, ignoring", value);
+    else
+      superframe_size = value / BITRATE_STEP * SUPERFRAME_MIN_SIZE;
+  }
+
+  if ((superframe_size % SUPERFRAME_MIN_SIZE) ||
+      (superframe_size > SUPERFRAME_MAX_SIZE)) {
+    GST_WARNING_OBJECT (dabplusparse, "invalid superframe size in caps, ignoring");
+    superframe_size = 0;
+  }
+
+  if ((superframe_size != 0) &&
+      (dabplusparse->superframe_size != 0) &&
+      (superframe_size != dabplusparse->superframe_size)) {
+    GST_INFO_OBJECT (dabplusparse, "superframe size changed to %u", superframe_size);
+    gst_dabplusparse_reset (dabplusparse);
+  }
+
+  dabplusparse->caps_superframe_size = superframe_size;
+
+  return TRUE;
+}
+
+/**
+ * gst_dabplusparse_clear_sink_caps_cache:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Drops memoized sink caps. The cookie is bumped as well,
+ * so that results of queries in progress are not stored.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_clear_sink_caps_cache (GstDabPlusParse * dabplusparse)
+{
+  guint i;
+
+  GST_OBJECT_LOCK (dabplusparse);
+  dabplusparse->caps_cookie++;
+  for (i = 0; i < DABPLUS_SINK_CAPS_CACHE_SIZE; ++i) {
+    gst_caps_replace (&dabplusparse->sink_caps_cache[i].filter, NULL);
+    gst_caps_replace (&dabplusparse->sink_caps_cache[i].caps, NULL);
+  }
+  dabplusparse->sink_caps_cache_next = 0;
+  GST_OBJECT_UNLOCK (dabplusparse);
+}
+
+/**
+ * gst_dabplusparse_src_link_changed:
+ * @pad: Source pad.
+ * @peer: Peer being linked or unlinked.
+ * @user_data: #GstDabPlusParse.
+ *
+ * Handler of "linked" and "unlinked" signals of the source pad,
+ * memoized sink caps depend on the peer.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_src_link_changed (GstPad * pad, GstPad * peer,
+    gpointer user_data)
+{
+  gst_dabplusparse_clear_sink_caps_cache (GST_DABPLUSPARSE (user_data));
+}
+
+/**
+ * gst_dabplusparse_sink_caps_cache_lookup:
+ * @dabplusparse: #GstDabPlusParse.
+ * @filter: Filter of the caps query (may be NULL).
+ *
+ * Must be called with the object lock held.
+ *
+ * Returns: Memoized result of gst_dabplusparse_sink_getcaps()
+ *          or NULL if there is none.
+ */
+static GstCaps *
+gst_dabplusparse_sink_caps_cache_lookup (GstDabPlusParse * dabplusparse,
+    GstCaps * filter)
+{
+  guint i;
+
+  for (i = 0; i < DABPLUS_SINK_CAPS_CACHE_SIZE; ++i) {
+    GstDabPlusCapsCacheEntry *entry = &dabplusparse->sink_caps_cache[i];
+
+    if (!entry->caps || (entry->cookie != dabplusparse->caps_cookie))
+      continue;
+
+    if ((entry->filter == filter) ||
+        (entry->filter && filter && gst_caps_is_strictly_equal (entry->filter, filter)))
+      return gst_caps_ref (entry->caps);
+  }
+
+  return NULL;
+}
+
+/**
+ * gst_dabplusparse_sink_caps_cache_store:
+ * @dabplusparse: #GstDabPlusParse.
+ * @filter: Filter of the caps query (may be NULL).
+ * @caps: Result of gst_dabplusparse_sink_getcaps().
+ *
+ * Memoizes @caps, replacing the oldest entry.
+ * Must be called with the object lock held.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_sink_caps_cache_store (GstDabPlusParse * dabplusparse,
+    GstCaps * filter, GstCaps * caps)
+{
+  GstDabPlusCapsCacheEntry *entry =
+    &dabplusparse->sink_caps_cache[dabplusparse->sink_caps_cache_next];
+
+  gst_caps_replace (&entry->filter, filter);
+  gst_caps_replace (&entry->caps, caps);
+  entry->cookie = dabplusparse->caps_cookie;
+
+  dabplusparse->sink_caps_cache_next =
+    (dabplusparse->sink_caps_cache_next + 1) % DABPLUS_SINK_CAPS_CACHE_SIZE;
+}
+
+/**
+ * gst_dabplusparse_sink_getcaps:
+ * @baseparse: #GstBaseParse.
+ * @filter: #GstCaps
+ *
+ * Implementation of "get_sink_caps" vmethod in #GstBaseParse class.
+ * Results are memoized per filter, until downstream asks for
+ * reconfiguration or the source pad is relinked.
+ *
+ * Returns: Our resulting #GstCaps.
+ */
+static GstCaps *
+gst_dabplusparse_sink_getcaps (GstBaseParse *baseparse, GstCaps *filter)
+{
+  GstCaps *peercaps, *templ;
+  GstCaps *res;
+  GstDabPlusParse *dabplusparse;
+  guint cookie;
+
+  dabplusparse = GST_DABPLUSPARSE (baseparse);
+
+  GST_OBJECT_LOCK (dabplusparse);
+  cookie = dabplusparse->caps_cookie;
+  res = gst_dabplusparse_sink_caps_cache_lookup (dabplusparse, filter);
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  if (res) {
+    GST_DEBUG_OBJECT (dabplusparse, "cached caps: %" GST_PTR_FORMAT, res);
+    return res;
+  }
+
+  GST_INFO_OBJECT (dabplusparse, "filter caps: %" GST_PTR_FORMAT, filter);
+
+  templ = gst_pad_get_pad_template_caps (GST_BASE_PARSE_SINK_PAD (baseparse));
+
+  if (filter) {
+    GstCaps *fcopy = gst_caps_copy (filter);
+    /* Remove the fields we convert */
+    gst_dabplusparse_remove_fields (fcopy);
+    gst_dabplusparse_add_conversion_fields (fcopy);
+    peercaps = gst_pad_peer_query_caps (GST_BASE_PARSE_SRC_PAD (baseparse), fcopy);
+    gst_caps_unref (fcopy);
+  } else
+    peercaps = gst_pad_peer_query_caps (GST_BASE_PARSE_SRC_PAD (baseparse), NULL);
+
+  if (peercaps) {
+    /* Remove the fields we convert */
+    peercaps = gst_caps_make_writable (peercaps);
+    gst_dabplusparse_remove_fields (peercaps);
+    gst_dabplusparse_add_conversion_fields (peercaps);
+
+    res = gst_caps_intersect_full (peercaps, templ, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (peercaps);
+    gst_caps_unref (templ);
+  } else {
+    res = templ;
+  }
+
+  if (filter) {
+    GstCaps *intersection;
+
+    intersection =
+        gst_caps_intersect_full (filter, res, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (res);
+    res = intersection;
+  }
+
+  GST_INFO_OBJECT (dabplusparse, "res caps: %" GST_PTR_FORMAT, res);
+
+  GST_OBJECT_LOCK (dabplusparse);
+  /* drop the result if reconfiguration was requested in the meantime */
+  if (cookie == dabplusparse->caps_cookie)
+    gst_dabplusparse_sink_caps_cache_store (dabplusparse, filter, res);
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  return res;
+}
+
+/**
+ * gst_dabplusparse_src_event:
+ * @baseparse: #GstBaseParse.
+ * @event: #GstEvent.
+ *
+ * Implementation of "src_event" vmethod in #GstBaseParse class.
+ * Reconfigure events invalidate memoized sink caps.
+ *
+ * Returns: TRUE if the event was handled.
+ */
+static gboolean
+gst_dabplusparse_src_event (GstBaseParse * baseparse, GstEvent * event)
+{
+  GstDabPlusParse *dabplusparse = GST_DABPLUSPARSE (baseparse);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_RECONFIGURE) {
+    GST_OBJECT_LOCK (dabplusparse);
+    dabplusparse->caps_cookie++;
+    GST_OBJECT_UNLOCK (dabplusparse);
+  }
+
+  return GST_BASE_PARSE_CLASS (gst_dabplusparse_parent_class)->src_event (
+    baseparse, event);
+}
+
+/**
+ * gst_dabplusparse_acquire_buffer:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Gets an output buffer from the pool, falling back to a newly allocated
+ * one if there is no usable pool.
+ *
+ * Returns: Output buffer holding gst_dabplusparse_get_pool_buffer_size() bytes.
+ */
+static GstBuffer *
+gst_dabplusparse_acquire_buffer (GstDabPlusParse * dabplusparse)
+{
+  GstBuffer *buffer = NULL;
+  guint size;
+
+  if (G_LIKELY (dabplusparse->pool) &&
+      (gst_buffer_pool_acquire_buffer (dabplusparse->pool, &buffer, NULL) == GST_FLOW_OK))
+    return buffer;
+
+  size = gst_dabplusparse_get_pool_buffer_size (dabplusparse);
+  return size ? gst_buffer_new_allocate (NULL, size, NULL) : gst_buffer_new ();
+}
+
+/**
+ * gst_dabplusparse_make_loas_frame:
+ * @dabplusparse: #GstDabPlusParse.
+ * @buffer: Superframe the access units are taken from.
+ * @hdr: Parsed header of the superframe.
+ * @first: Index of the first access unit to be put into the frame.
+ * @drop_corrupted: Whether access units with invalid CRC shall be skipped.
+ * @next: Set to the index of the first access unit not put into the frame.
+ *
+ * Creates a LOAS frame (AudioSyncStream) with one AudioMuxElement carrying
+ * the StreamMuxConfig and as many access units, starting from @first,
+ * as fit into the maximum LOAS frame length.
+ *
+ * Returns: LOAS frame or NULL on error.
+ */
+static GstBuffer *
+gst_dabplusparse_make_loas_frame (GstDabPlusParse * dabplusparse,
+    GstBuffer * buffer, const GstDabPlusSuperframeHeader * hdr,
+    guint first, gboolean drop_corrupted, guint * next)
+{
+  GstBitWriter bw;
+  GstMapInfo in, out;
+  GstBuffer *frame;
+  guint bits = LOAS_MUX_CONFIG_BITS;
+  guint mux_length;
+  guint n = 0;
+  guint i, size;
+
+  for (i = first; i < hdr->num_aus; ++i) {
+    guint au_bits;
+
+    if (G_UNLIKELY (!hdr->au[i].crc_ok) && drop_corrupted)
+      continue;
+
+    /* PayloadLengthInfo() and PayloadMux() */
+    au_bits = 8 * (hdr->au[i].size / 255 + 1 + hdr->au[i].size);
+    if ((bits + au_bits + 7) / 8 > LOAS_MAX_MUX_LENGTH) {
+      if (n == 0) {
+        GST_ERROR_OBJECT (dabplusparse, "access unit is too big for loas");
+        return NULL;
+      }
+      break;
+    }
+
+    bits += au_bits;
+    ++n;
+  }
+
+  *next = i;
+  mux_length = (bits + 7) / 8;
+
+  if (!gst_buffer_map (buffer, &in, GST_MAP_READ))
+    return NULL;
+
+  frame = gst_dabplusparse_acquire_buffer (dabplusparse);
+  if (G_UNLIKELY (!gst_buffer_map (frame, &out, GST_MAP_WRITE))) {
+    gst_buffer_unref (frame);
+    gst_buffer_unmap (buffer, &in);
+    return NULL;
+  }
+
+  gst_bit_writer_init_with_data (&bw, out.data, out.size, FALSE);
+
+  /* AudioSyncStream() */
+  gst_bit_writer_put_bits_uint16_unchecked (&bw, 0x2B7, 11);
+  gst_bit_writer_put_bits_uint16_unchecked (&bw, mux_length, 13);
+
+  /* AudioMuxElement(muxConfigPresent = 1) */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 0, 1);   /* useSameStreamMux */
+
+  /* StreamMuxConfig() */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 0, 1);   /* audioMuxVersion */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 1, 1);   /* allStreamsSameTimeFraming */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, n - 1, 6); /* numSubFrames */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 0, 4);   /* numProgram */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 0, 3);   /* numLayer */
+  gst_bit_writer_put_bits_uint16_unchecked (&bw,
+      dabplusparse->audio_specific_config, 16);          /* AudioSpecificConfig() */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 0, 3);   /* frameLengthType */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 0xFF, 8); /* latmBufferFullness */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 0, 1);   /* otherDataPresent */
+  gst_bit_writer_put_bits_uint8_unchecked (&bw, 0, 1);   /* crcCheckPresent */
+
+  for (i = first; i < *next; ++i) {
+    if (G_UNLIKELY (!hdr->au[i].crc_ok) && drop_corrupted)
+      continue;
+
+    /* PayloadLengthInfo() */
+    for (size = hdr->au[i].size; size >= 255; size -= 255)
+      gst_bit_writer_put_bits_uint8_unchecked (&bw, 255, 8);
+    gst_bit_writer_put_bits_uint8_unchecked (&bw, size, 8);
+
+    /* PayloadMux() */
+    gst_bit_writer_put_bytes_unchecked (&bw, in.data + hdr->au[i].start,
+        hdr->au[i].size);
+  }
+
+  gst_bit_writer_align_bytes_unchecked (&bw, 0);
+
+  gst_buffer_unmap (frame, &out);
+  gst_buffer_unmap (buffer, &in);
+
+  gst_buffer_set_size (frame, LOAS_HEADER_LENGTH + mux_length);
+
+  return frame;
+}
+
+/**
+ * gst_dabplusparse_make_output_buffer:
+ * @dabplusparse: #GstDabPlusParse.
+ * @buffer: Superframe the access units are taken from.
+ * @hdr: Parsed header of the superframe.
+ * @first: Index of the first access unit to be put into the buffer.
+ * @drop_corrupted: Whether access units with invalid CRC shall be skipped.
+ * @next: Set to the index of the first access unit not put into the buffer.
+ *
+ * Creates output buffer in negotiated stream format. Raw and ADTS buffers
+ * carry exactly one access unit, LOAS frames can carry several of them.
+ *
+ * Returns: Output buffer or NULL on error.
+ */
+static GstBuffer *
+gst_dabplusparse_make_output_buffer (GstDabPlusParse * dabplusparse,
+    GstBuffer * buffer, const GstDabPlusSuperframeHeader * hdr,
+    guint first, gboolean drop_corrupted, guint * next)
+{
+  GstBuffer *out_buffer;
+  guint i;
+
+  if (dabplusparse->o_header_type == DABPLUS_HEADER_LOAS) {
+    out_buffer = gst_dabplusparse_make_loas_frame (dabplusparse, buffer, hdr,
+        first, drop_corrupted, next);
+    if (G_UNLIKELY (!out_buffer)) {
+      GST_ERROR_OBJECT (dabplusparse, "failed to create loas frame");
+      return NULL;
+    }
+  } else {
+    out_buffer = gst_dabplusparse_acquire_buffer (dabplusparse);
+    *next = first + 1;
+
+    if (dabplusparse->o_header_type == DABPLUS_HEADER_ADTS) {
+      if (!gst_dabplusparse_write_adts_header (dabplusparse, out_buffer,
+          hdr->au[first].size)) {
+        GST_ERROR_OBJECT (dabplusparse, "failed to prepend adts headers to frame");
+        gst_buffer_unref (out_buffer);
+        return NULL;
+      }
+    }
+
+    /* access unit shares memory with the superframe, nothing is copied */
+    gst_buffer_copy_into (out_buffer, buffer, GST_BUFFER_COPY_MEMORY,
+        hdr->au[first].start, hdr->au[first].size);
+  }
+
+  for (i = first; i < *next; ++i)
+    if (G_UNLIKELY (!hdr->au[i].crc_ok)) {
+      GST_BUFFER_FLAG_SET (out_buffer, GST_BUFFER_FLAG_CORRUPTED);
+      break;
+    }
+
+  return out_buffer;
+}
+
+/**
+ * gst_dabplusparse_superframe_pts:
+ * @dabplusparse: #GstDabPlusParse.
+ * @frame: Frame holding the superframe.
+ *
+ * Timestamp of the superframe, taken from upstream if it is known.
+ * Otherwise it follows from the previous superframe, every superframe_size
+ * bytes (also the ones skipped while regaining sync) accounting for 120 ms.
+ * With no previous superframe (start, seek, discontinuity) the byte offset
+ * of the superframe is converted to time the same way.
+ *
+ * Returns: PTS of the superframe.
+ */
+static GstClockTime
+gst_dabplusparse_superframe_pts (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame)
+{
+  GstClockTime pts = GST_BUFFER_PTS (frame->buffer);
+
+  if (GST_BUFFER_FLAG_IS_SET (frame->buffer, GST_BUFFER_FLAG_DISCONT))
+    dabplusparse->next_pts = GST_CLOCK_TIME_NONE;
+
+  if (!GST_CLOCK_TIME_IS_VALID (pts)) {
+    if (GST_CLOCK_TIME_IS_VALID (dabplusparse->next_pts) &&
+        (frame->offset >= dabplusparse->next_offset))
+      pts = dabplusparse->next_pts + gst_util_uint64_scale (
+        frame->offset - dabplusparse->next_offset,
+        SUPERFRAME_DURATION, dabplusparse->superframe_size);
+    else {
+      gint64 time = 0;
+
+      gst_dabplusparse_convert (GST_BASE_PARSE (dabplusparse), GST_FORMAT_BYTES,
+        frame->offset, GST_FORMAT_TIME, &time);
+      pts = time;
+    }
+  }
+
+  dabplusparse->next_pts = pts + SUPERFRAME_DURATION;
+  dabplusparse->next_offset = frame->offset + dabplusparse->superframe_size;
+  return pts;
+}
+
+/**
+ * gst_dabplusparse_set_timestamps:
+ * @hdr: Parsed header of the superframe.
+ * @buffer: Output buffer.
+ * @pts: PTS of the superframe.
+ * @first: Index of the first access unit in @buffer.
+ * @next: Index of the first access unit following @buffer.
+ *
+ * Sets PTS, DTS and duration of @buffer. All access units of a superframe
+ * have the same length (960 samples at core sampling rate), so they
+ * divide the 120 ms of the superframe evenly.
+ */
+static void
+gst_dabplusparse_set_timestamps (const GstDabPlusSuperframeHeader * hdr,
+    GstBuffer * buffer, GstClockTime pts, guint first, guint next)
+{
+  GstClockTime start = gst_util_uint64_scale_int (SUPERFRAME_DURATION, first, hdr->num_aus);
+  GstClockTime end = gst_util_uint64_scale_int (SUPERFRAME_DURATION, next, hdr->num_aus);
+
+  GST_BUFFER_PTS (buffer) = pts + start;
+  GST_BUFFER_DTS (buffer) = pts + start;
+  GST_BUFFER_DURATION (buffer) = end - start;
+}
+
+/**
+ * gst_dabplusparse_make_superframe_buffer:
+ * @dabplusparse: #GstDabPlusParse.
+ * @buffer: Buffer holding the (corrected) superframe.
+ * @hdr: Parsed header of the superframe.
+ * @pts: PTS of the superframe.
+ *
+ * Creates output buffer carrying the whole superframe, with its layout
+ * described by #GstDabPlusSuperframeMeta. Access units are never dropped
+ * here, instead the buffer is marked as corrupted if any of them has
+ * invalid CRC.
+ *
+ * Returns: Output buffer.
+ */
+static GstBuffer *
+gst_dabplusparse_make_superframe_buffer (GstDabPlusParse * dabplusparse,
+    GstBuffer * buffer, const GstDabPlusSuperframeHeader * hdr, GstClockTime pts)
+{
+  GstDabPlusSuperframeMeta *smeta;
+  GstBuffer *out_buffer;
+  guint i;
+
+  /* superframe memory is shared, only the meta is new */
+  out_buffer = gst_dabplusparse_acquire_buffer (dabplusparse);
+  gst_buffer_copy_into (out_buffer, buffer, GST_BUFFER_COPY_MEMORY,
+      0, dabplusparse->superframe_size);
+
+  smeta = gst_buffer_add_dabplus_superframe_meta (out_buffer);
+  smeta->dac_rate = hdr->dac_rate;
+  smeta->sbr_flag = hdr->sbr_flag;
+  smeta->aac_channel_mode = hdr->aac_channel_mode;
+  smeta->ps_flag = hdr->ps_flag;
+  smeta->mpeg_surround_config = hdr->mpeg_surround_config;
+  smeta->num_aus = hdr->num_aus;
+
+  for (i = 0; i < hdr->num_aus; ++i) {
+    smeta->au[i].start = hdr->au[i].start;
+    smeta->au[i].size = hdr->au[i].size;
+    smeta->au[i].crc_ok = hdr->au[i].crc_ok;
+
+    if (G_UNLIKELY (!hdr->au[i].crc_ok))
+      GST_BUFFER_FLAG_SET (out_buffer, GST_BUFFER_FLAG_CORRUPTED);
+  }
+
+  gst_dabplusparse_set_timestamps (hdr, out_buffer, pts, 0, hdr->num_aus);
+
+  return out_buffer;
+}
+
+/**
+ * gst_dabplusparse_push_superframe:
+ * @dabplusparse: #GstDabPlusParse.
+ * @frame: #GstBaseParseFrame holding the superframe.
+ * @buffer: Buffer holding the (corrected) superframe.
+ * @hdr: Parsed header of the superframe.
+ * @pts: PTS of the superframe.
+ *
+ * Forwards the whole superframe as one buffer,
+ * see gst_dabplusparse_make_superframe_buffer().
+ *
+ * Returns: a #GstFlowReturn.
+ */
+static GstFlowReturn
+gst_dabplusparse_push_superframe (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame, GstBuffer * buffer,
+    const GstDabPlusSuperframeHeader * hdr, GstClockTime pts)
+{
+  frame->out_buffer = gst_dabplusparse_make_superframe_buffer (dabplusparse,
+    buffer, hdr, pts);
+
+  return gst_base_parse_finish_frame (GST_BASE_PARSE (dabplusparse), frame,
+    dabplusparse->superframe_size);
+}
+
+/**
+ * gst_dabplusparse_make_au_list:
+ * @dabplusparse: #GstDabPlusParse.
+ * @buffer: Superframe the access units are taken from.
+ * @hdr: Parsed header of the superframe.
+ * @pts: PTS of the superframe.
+ * @drop_corrupted: Whether access units with invalid CRC shall be skipped.
+ * @discont: Whether the first output buffer shall be marked as discontinuity.
+ *
+ * Creates output buffers for all access units of the superframe.
+ *
+ * Returns: #GstBufferList of output buffers (possibly empty),
+ *          or NULL on error.
+ */
+static GstBufferList *
+gst_dabplusparse_make_au_list (GstDabPlusParse * dabplusparse,
+    GstBuffer * buffer, const GstDabPlusSuperframeHeader * hdr,
+    GstClockTime pts, gboolean drop_corrupted, gboolean discont)
+{
+  GstBufferList *list;
+  guint i, next;
+
+  list = gst_buffer_list_new_sized (hdr->num_aus);
+
+  for (i = 0; i < hdr->num_aus; i = next) {
+    GstBuffer *au_buffer;
+
+    next = i + 1;
+
+    if (G_UNLIKELY (!hdr->au[i].crc_ok) && drop_corrupted) {
+      GST_DEBUG_OBJECT (dabplusparse, "dropping access unit %u", i);
+      continue;
+    }
+
+    au_buffer = gst_dabplusparse_make_output_buffer (dabplusparse, buffer,
+        hdr, i, drop_corrupted, &next);
+    if (G_UNLIKELY (!au_buffer)) {
+      gst_buffer_list_unref (list);
+      return NULL;
+    }
+
+    gst_dabplusparse_set_timestamps (hdr, au_buffer, pts, i, next);
+
+    if (discont && (gst_buffer_list_length (list) == 0))
+      GST_BUFFER_FLAG_SET (au_buffer, GST_BUFFER_FLAG_DISCONT);
+
+    gst_buffer_list_add (list, au_buffer);
+  }
+
+  return list;
+}
+
+/**
+ * gst_dabplusparse_index_superframe:
+ * @dabplusparse: #GstDabPlusParse.
+ * @frame: #GstBaseParseFrame holding the superframe.
+ * @buffer: Superframe (after Reed-Solomon correction).
+ * @hdr: #GstDabPlusSuperframeHeader describing the superframe.
+ * @pts: Timestamp of the superframe.
+ *
+ * Adds the superframe to the index being written, if any.
+ * Superframes have to come in order, if they don't (e.g. because of a seek)
+ * the index is abandoned.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_index_superframe (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame, GstBuffer * buffer,
+    const GstDabPlusSuperframeHeader * hdr, GstClockTime pts)
+{
+  GstDabPlusIndexEntry entry;
+  guint i;
+
+  if (!dabplusparse->index_writing)
+    return;
+
+  if (!dabplusparse->index_writer) {
+    gchar *location;
+
+    GST_OBJECT_LOCK (dabplusparse);
+    location = g_strdup (dabplusparse->index_location);
+    GST_OBJECT_UNLOCK (dabplusparse);
+
+    dabplusparse->index_writer = location ?
+      gst_dabplus_index_writer_new (location, dabplusparse->superframe_size) : NULL;
+    if (!dabplusparse->index_writer) {
+      GST_WARNING_OBJECT (dabplusparse, "cannot create index '%s'",
+        GST_STR_NULL (location));
+      dabplusparse->index_writing = FALSE;
+      g_free (location);
+      return;
+    }
+    g_free (location);
+  }
+
+  entry.offset = frame->offset;
+  entry.pts = pts;
+  entry.flags = 0;
+
+  if (buffer != frame->buffer)
+    entry.flags |= GST_DABPLUS_INDEX_FLAG_RS_CORRECTED;
+
+  for (i = 0; i < hdr->num_aus; ++i)
+    if (!hdr->au[i].crc_ok)
+      entry.flags |= GST_DABPLUS_INDEX_FLAG_AU_CRC_ERRORS;
+
+  if (!gst_dabplus_index_writer_add (dabplusparse->index_writer, &entry)) {
+    GST_INFO_OBJECT (dabplusparse, "superframe at offset %" G_GUINT64_FORMAT
+      " cannot be indexed, abandoning index", frame->offset);
+    gst_dabplusparse_close_index (dabplusparse, FALSE);
+  }
+}
+
+/**
+ * gst_dabplusparse_push_list:
+ * @dabplusparse: #GstDabPlusParse.
+ * @list: (transfer full): Output buffers.
+ * @as_list: Whether @list is pushed as a whole or buffer by buffer.
+ *
+ * Pushes output buffers straight on the source pad, doing what
+ * #GstBaseParse does for the frames it pushes by itself: buffers outside
+ * of the output segment (e.g. before the target of an accurate seek) are
+ * dropped, reaching its end finishes the stream, and the segment position
+ * follows what has been pushed, so position queries keep working.
+ *
+ * Returns: a #GstFlowReturn.
+ */
+static GstFlowReturn
+gst_dabplusparse_push_list (GstDabPlusParse * dabplusparse,
+    GstBufferList * list, gboolean as_list)
+{
+  GstBaseParse *baseparse = GST_BASE_PARSE (dabplusparse);
+  GstPad *srcpad = GST_BASE_PARSE_SRC_PAD (dabplusparse);
+  GstBufferList *clipped;
+  GstSegment segment;
+  GstClockTime position = GST_CLOCK_TIME_NONE;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gboolean discont = FALSE;
+  gboolean eos = FALSE;
+  guint i, n;
+
+  GST_OBJECT_LOCK (dabplusparse);
+  segment = baseparse->segment;
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  n = gst_buffer_list_length (list);
+  clipped = gst_buffer_list_new_sized (n);
+
+  for (i = 0; i < n; ++i) {
+    GstBuffer *buffer = gst_buffer_list_get (list, i);
+    GstClockTime start = GST_BUFFER_PTS (buffer);
+    GstClockTime stop = GST_BUFFER_DURATION_IS_VALID (buffer) ?
+      start + GST_BUFFER_DURATION (buffer) : GST_CLOCK_TIME_NONE;
+
+    if ((segment.format == GST_FORMAT_TIME) && GST_CLOCK_TIME_IS_VALID (start)) {
+      if ((segment.rate > 0.0) && GST_CLOCK_TIME_IS_VALID (segment.stop) &&
+          (start >= segment.stop)) {
+        GST_LOG_OBJECT (dabplusparse, "dropping buffers after segment");
+        eos = TRUE;
+        break;
+      }
+
+      if (!gst_segment_clip (&segment, GST_FORMAT_TIME, start, stop, NULL, NULL)) {
+        GST_LOG_OBJECT (dabplusparse, "dropping buffer before segment");
+        discont |= GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+        continue;
+      }
+    }
+
+    buffer = gst_buffer_ref (buffer);
+    if (discont) {
+      buffer = gst_buffer_make_writable (buffer);
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+      discont = FALSE;
+    }
+
+    gst_buffer_list_add (clipped, buffer);
+    position = GST_CLOCK_TIME_IS_VALID (stop) ? stop : start;
+  }
+
+  gst_buffer_list_unref (list);
+
+  n = gst_buffer_list_length (clipped);
+  if (n == 0) {
+    gst_buffer_list_unref (clipped);
+    return eos ? GST_FLOW_EOS : GST_FLOW_OK;
+  }
+
+  if (as_list)
+    ret = gst_pad_push_list (srcpad, clipped);
+  else {
+    for (i = 0; (i < n) && (ret == GST_FLOW_OK); ++i)
+      ret = gst_pad_push (srcpad, gst_buffer_ref (gst_buffer_list_get (clipped, i)));
+    gst_buffer_list_unref (clipped);
   }
 
-  if (!found) {
-    *skipsize = i;
-    return FALSE;
+  if ((ret == GST_FLOW_OK) && GST_CLOCK_TIME_IS_VALID (position)) {
+    GST_OBJECT_LOCK (dabplusparse);
+    if (!GST_CLOCK_TIME_IS_VALID (baseparse->segment.position) ||
+        (baseparse->segment.position < position))
+      baseparse->segment.position = position;
+    GST_OBJECT_UNLOCK (dabplusparse);
+  }
+
+  return ((ret == GST_FLOW_OK) && eos) ? GST_FLOW_EOS : ret;
+}
+
+/**
+ * gst_dabplusparse_emit_wake:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Wakes up threads waiting for the emission stage, if there are any.
+ * To be called after the state they wait for has been changed.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_emit_wake (GstDabPlusParse * dabplusparse)
+{
+  if (g_atomic_int_get (&dabplusparse->emit_waiting)) {
+    g_mutex_lock (&dabplusparse->emit_lock);
+    g_cond_broadcast (&dabplusparse->emit_cond);
+    g_mutex_unlock (&dabplusparse->emit_lock);
+  }
+}
+
+typedef gboolean (*GstDabPlusEmitCondition) (GstDabPlusParse * dabplusparse);
+
+/**
+ * gst_dabplusparse_emit_wait:
+ * @dabplusparse: #GstDabPlusParse.
+ * @condition: What to wait for.
+ *
+ * Waits until @condition holds. The ring itself is lock free, the lock
+ * is only taken when there is nothing to do but sleep.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_emit_wait (GstDabPlusParse * dabplusparse,
+    GstDabPlusEmitCondition condition)
+{
+  if (condition (dabplusparse))
+    return;
+
+  g_mutex_lock (&dabplusparse->emit_lock);
+  g_atomic_int_inc (&dabplusparse->emit_waiting);
+  while (!condition (dabplusparse))
+    g_cond_wait (&dabplusparse->emit_cond, &dabplusparse->emit_lock);
+  g_atomic_int_add (&dabplusparse->emit_waiting, -1);
+  g_mutex_unlock (&dabplusparse->emit_lock);
+}
+
+static gboolean
+gst_dabplusparse_emit_can_queue (GstDabPlusParse * dabplusparse)
+{
+  return g_atomic_int_get (&dabplusparse->emit_flushing) ||
+    ((guint) g_atomic_int_get (&dabplusparse->emit_queued) -
+      (guint) g_atomic_int_get (&dabplusparse->emit_done) < dabplusparse->emit_depth);
+}
+
+static gboolean
+gst_dabplusparse_emit_has_work (GstDabPlusParse * dabplusparse)
+{
+  return g_atomic_int_get (&dabplusparse->emit_stopping) ||
+    (g_atomic_int_get (&dabplusparse->emit_queued) !=
+      g_atomic_int_get (&dabplusparse->emit_done));
+}
+
+static gboolean
+gst_dabplusparse_emit_drained (GstDabPlusParse * dabplusparse)
+{
+  return g_atomic_int_get (&dabplusparse->emit_queued) ==
+    g_atomic_int_get (&dabplusparse->emit_done);
+}
+
+/**
+ * gst_dabplusparse_emit_drain:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Waits until all queued superframes have been pushed downstream.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_emit_drain (GstDabPlusParse * dabplusparse)
+{
+  if (dabplusparse->emit_ring && (g_thread_self () != dabplusparse->emit_thread))
+    gst_dabplusparse_emit_wait (dabplusparse, gst_dabplusparse_emit_drained);
+}
+
+/**
+ * gst_dabplusparse_free_superframe_desc:
+ * @desc: #GstDabPlusSuperframeDesc.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_free_superframe_desc (GstDabPlusSuperframeDesc * desc)
+{
+  gst_buffer_unref (desc->superframe);
+  g_free (desc);
+}
+
+/**
+ * gst_dabplusparse_emit_superframe:
+ * @dabplusparse: #GstDabPlusParse.
+ * @desc: #GstDabPlusSuperframeDesc.
+ *
+ * Emission stage counterpart of finishing a superframe: creates output
+ * buffers of the superframe and pushes them downstream, clipped to the
+ * segment and tracking its position like the base class would.
+ *
+ * Returns: a #GstFlowReturn.
+ */
+static GstFlowReturn
+gst_dabplusparse_emit_superframe (GstDabPlusParse * dabplusparse,
+    GstDabPlusSuperframeDesc * desc)
+{
+  GstBufferList *list;
+  GstBuffer *buffer;
+
+  if (dabplusparse->o_header_type == DABPLUS_HEADER_SUPERFRAME) {
+    buffer = gst_dabplusparse_make_superframe_buffer (dabplusparse,
+      desc->superframe, &desc->header, desc->pts);
+    if (desc->discont)
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+    list = gst_buffer_list_new_sized (1);
+    gst_buffer_list_add (list, buffer);
+    return gst_dabplusparse_push_list (dabplusparse, list, FALSE);
   }
 
-  superframe_size = offsets[1] - offsets[0];
+  list = gst_dabplusparse_make_au_list (dabplusparse, desc->superframe,
+    &desc->header, desc->pts, desc->drop_corrupted, desc->discont);
+  if (G_UNLIKELY (!list))
+    return GST_FLOW_ERROR;
 
-  if (superframe_size % SUPERFRAME_MIN_SIZE) {
-    GST_DEBUG_OBJECT (dabplusparse, "superframe size is not multiple of %u", SUPERFRAME_MIN_SIZE);
-    *skipsize = i;
-    return FALSE;
+  return gst_dabplusparse_push_list (dabplusparse, list, desc->use_list);
+}
+
+/**
+ * gst_dabplusparse_emit_loop:
+ * @data: #GstDabPlusParse.
+ *
+ * Emission thread, consumer of the ring. Once pushing fails, superframes
+ * are dropped until the next flush (the flow return is passed upstream
+ * by gst_dabplusparse_queue_superframe()).
+ *
+ * Returns: NULL.
+ */
+static gpointer
+gst_dabplusparse_emit_loop (gpointer data)
+{
+  GstDabPlusParse *dabplusparse = data;
+  GstDabPlusSuperframeDesc *desc;
+  GstFlowReturn ret;
+
+  for (;;) {
+    gst_dabplusparse_emit_wait (dabplusparse, gst_dabplusparse_emit_has_work);
+
+    desc = gst_dabplus_ring_pop (dabplusparse->emit_ring);
+    if (!desc)
+      break; /* stopping and nothing left */
+
+    if (!g_atomic_int_get (&dabplusparse->emit_flushing) &&
+        !g_atomic_int_get (&dabplusparse->emit_stopping) &&
+        (g_atomic_int_get (&dabplusparse->emit_flow) == GST_FLOW_OK)) {
+      ret = gst_dabplusparse_emit_superframe (dabplusparse, desc);
+      if (ret != GST_FLOW_OK) {
+        GST_DEBUG_OBJECT (dabplusparse, "pushing superframe failed: %s",
+          gst_flow_get_name (ret));
+        g_atomic_int_set (&dabplusparse->emit_flow, ret);
+      }
+    }
+
+    gst_dabplusparse_free_superframe_desc (desc);
+    g_atomic_int_inc (&dabplusparse->emit_done);
+    gst_dabplusparse_emit_wake (dabplusparse);
   }
 
-  GST_INFO_OBJECT (dabplusparse, "superframe size: %u (%u x %u)",
-    superframe_size, superframe_size / SUPERFRAME_MIN_SIZE, SUPERFRAME_MIN_SIZE);
+  return NULL;
+}
+
+/**
+ * gst_dabplusparse_emit_probe:
+ * @pad: Source pad.
+ * @info: #GstPadProbeInfo of a downstream event.
+ * @user_data: #GstDabPlusParse.
+ *
+ * Keeps events (also the ones the base class pushes by itself) in order with
+ * queued superframes: serialized events wait until the ring is drained,
+ * flushes drop whatever is queued.
+ *
+ * Returns: GST_PAD_PROBE_OK.
+ */
+static GstPadProbeReturn
+gst_dabplusparse_emit_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstDabPlusParse *dabplusparse = user_data;
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
 
-  dabplusparse->superframe_size = superframe_size;
+  /* sticky events pushed along with data come from the emission thread */
+  if (g_thread_self () == dabplusparse->emit_thread)
+    return GST_PAD_PROBE_OK;
 
-  gst_base_parse_set_min_frame_size (GST_BASE_PARSE (dabplusparse), superframe_size);
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      g_atomic_int_set (&dabplusparse->emit_flushing, TRUE);
+      gst_dabplusparse_emit_wake (dabplusparse);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_dabplusparse_emit_drain (dabplusparse);
+      g_atomic_int_set (&dabplusparse->emit_flow, GST_FLOW_OK);
+      g_atomic_int_set (&dabplusparse->emit_flushing, FALSE);
+      break;
+    default:
+      if (GST_EVENT_IS_SERIALIZED (event))
+        gst_dabplusparse_emit_drain (dabplusparse);
+      break;
+  }
 
-  return TRUE;
+  return GST_PAD_PROBE_OK;
 }
 
 /**
- * gst_dabplusparse_get_audio_profile_object_type
+ * gst_dabplusparse_emit_start:
  * @dabplusparse: #GstDabPlusParse.
+ * @depth: Number of superframes which can be queued.
  *
- * Gets the MPEG-2 profile or the MPEG-4 object type value corresponding to the
- * mpegversion and profile of @dabplusparse's src pad caps, according to the
- * values defined by table 1.A.11 in ISO/IEC 14496-3.
+ * Starts the emission thread.
  *
- * Returns: the profile or object type value corresponding to @dabplusparse's src
- * pad caps, if such a value exists; otherwise G_MAXUINT8.
+ * Returns: None.
  */
-static guint8
-gst_dabplusparse_get_audio_profile_object_type (GstDabPlusParse * dabplusparse)
+static void
+gst_dabplusparse_emit_start (GstDabPlusParse * dabplusparse, guint depth)
 {
-  GstCaps *srccaps;
-  GstStructure *srcstruct;
-  const gchar *profile;
-  guint8 ret;
+  GST_INFO_OBJECT (dabplusparse, "pushing from emission thread, %u superframes queued at most",
+    depth);
+
+  dabplusparse->emit_depth = depth;
+  dabplusparse->emit_ring = gst_dabplus_ring_new (depth);
+  dabplusparse->emit_queued = 0;
+  dabplusparse->emit_done = 0;
+  dabplusparse->emit_flow = GST_FLOW_OK;
+  dabplusparse->emit_flushing = FALSE;
+  dabplusparse->emit_stopping = FALSE;
+
+  dabplusparse->emit_thread = g_thread_new ("dabplusemit",
+    gst_dabplusparse_emit_loop, dabplusparse);
+  dabplusparse->emit_probe = gst_pad_add_probe (GST_BASE_PARSE_SRC_PAD (dabplusparse),
+    GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+    gst_dabplusparse_emit_probe, dabplusparse, NULL);
+}
 
-  srccaps = gst_pad_get_current_caps (GST_BASE_PARSE_SRC_PAD (dabplusparse));
-  srcstruct = gst_caps_get_structure (srccaps, 0);
-  profile = gst_structure_get_string (srcstruct, "profile");
-  if (G_UNLIKELY (profile == NULL)) {
-    gst_caps_unref (srccaps);
-    return G_MAXUINT8;
+/**
+ * gst_dabplusparse_emit_stop:
+ * @dabplusparse: #GstDabPlusParse.
+ *
+ * Stops the emission thread, superframes still queued are dropped.
+ *
+ * Returns: None.
+ */
+static void
+gst_dabplusparse_emit_stop (GstDabPlusParse * dabplusparse)
+{
+  if (!dabplusparse->emit_thread)
+    return;
+
+  gst_pad_remove_probe (GST_BASE_PARSE_SRC_PAD (dabplusparse),
+    dabplusparse->emit_probe);
+  dabplusparse->emit_probe = 0;
+
+  g_atomic_int_set (&dabplusparse->emit_stopping, TRUE);
+  gst_dabplusparse_emit_wake (dabplusparse);
+  g_thread_join (dabplusparse->emit_thread);
+  dabplusparse->emit_thread = NULL;
+
+  gst_dabplus_ring_free (dabplusparse->emit_ring);
+  dabplusparse->emit_ring = NULL;
+  dabplusparse->emit_depth = 0;
+}
+
+/**
+ * gst_dabplusparse_queue_superframe:
+ * @dabplusparse: #GstDabPlusParse.
+ * @frame: #GstBaseParseFrame holding the superframe.
+ * @buffer: Buffer the access units are taken from.
+ * @hdr: Parsed header of the superframe.
+ * @pts: PTS of the superframe.
+ * @drop_corrupted: Whether access units with invalid CRC shall be skipped.
+ * @use_list: Whether access units shall be pushed as one #GstBufferList.
+ *
+ * Consumes the superframe and hands it over to the emission thread,
+ * waiting for room in the ring if downstream is slow.
+ *
+ * Returns: a #GstFlowReturn, failures of the emission thread included.
+ */
+static GstFlowReturn
+gst_dabplusparse_queue_superframe (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame, GstBuffer * buffer,
+    const GstDabPlusSuperframeHeader * hdr, GstClockTime pts,
+    gboolean drop_corrupted, gboolean use_list)
+{
+  GstDabPlusSuperframeDesc *desc;
+  GstFlowReturn ret;
+
+  desc = g_new (GstDabPlusSuperframeDesc, 1);
+  desc->superframe = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+    0, dabplusparse->superframe_size);
+  desc->header = *hdr;
+  desc->pts = pts;
+  desc->discont = GST_BUFFER_FLAG_IS_SET (frame->buffer, GST_BUFFER_FLAG_DISCONT);
+  desc->drop_corrupted = drop_corrupted;
+  desc->use_list = use_list;
+
+  /* Input is consumed right away. Events the base class has pending
+   * go downstream now, after what has been queued before (see emit_probe). */
+  frame->flags |= GST_BASE_PARSE_FRAME_FLAG_DROP;
+  ret = gst_base_parse_finish_frame (GST_BASE_PARSE (dabplusparse), frame,
+    dabplusparse->superframe_size);
+  if (ret != GST_FLOW_OK) {
+    gst_dabplusparse_free_superframe_desc (desc);
+    return ret;
   }
 
-  if (g_strcmp0 (profile, "main") == 0) {
-    ret = (guint8) 0U;
-  } else if (g_strcmp0 (profile, "lc") == 0) {
-    ret = (guint8) 1U;
-  } else if (g_strcmp0 (profile, "ssr") == 0) {
-    ret = (guint8) 2U;
-  } else if (g_strcmp0 (profile, "ltp") == 0) {
-    ret = (guint8) 3U;
-  } else {
-    ret = G_MAXUINT8;
+  gst_dabplusparse_emit_wait (dabplusparse, gst_dabplusparse_emit_can_queue);
+  if (g_atomic_int_get (&dabplusparse->emit_flushing)) {
+    gst_dabplusparse_free_superframe_desc (desc);
+    return GST_FLOW_FLUSHING;
   }
 
-  gst_caps_unref (srccaps);
-  return ret;
+  gst_dabplus_ring_push (dabplusparse->emit_ring, desc);
+  g_atomic_int_inc (&dabplusparse->emit_queued);
+  gst_dabplusparse_emit_wake (dabplusparse);
+
+  return (GstFlowReturn) g_atomic_int_get (&dabplusparse->emit_flow);
 }
 
 /**
- * gst_dabplusparse_get_audio_channel_configuration
- * @num_channels: number of audio channels.
+ * gst_dabplusparse_finish_superframe:
+ * @dabplusparse: #GstDabPlusParse.
+ * @frame: #GstBaseParseFrame holding the superframe.
+ * @buffer: Buffer the access units are taken from.
+ * @hdr: Parsed header of the superframe.
  *
- * Gets the Channel Configuration value, as defined by table 1.19 in ISO/IEC
- * 14496-3, for a given number of audio channels.
+ * Updates src caps if audio parameters have changed, pushes all access
+ * units of the superframe downstream and finally drops the superframe itself.
+ * With #GstDabPlusParse:buffer-list set, access units are pushed together
+ * as one #GstBufferList.
  *
- * Returns: the Channel Configuration value corresponding to @num_channels, if
- * such a value exists; otherwise G_MAXUINT8.
+ * Returns: a #GstFlowReturn.
  */
-static guint8
-gst_dabplusparse_get_audio_channel_configuration (gint num_channels)
+static GstFlowReturn
+gst_dabplusparse_finish_superframe (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame, GstBuffer * buffer,
+    const GstDabPlusSuperframeHeader * hdr)
 {
-  if (num_channels >= 1 && num_channels <= 6)   /* Mono up to & including 5.1 */
-    return (guint8) num_channels;
-  else if (num_channels == 8)   /* 7.1 */
-    return (guint8) 7U;
-  else
-    return G_MAXUINT8;
+  gboolean status;
+  gboolean drop_corrupted;
+  gboolean use_list;
+  GstBufferList *list = NULL;
+  GstClockTime pts;
+  GstFlowReturn ret;
+  guint i, next;
+
+  GST_OBJECT_LOCK (dabplusparse);
+  drop_corrupted = (dabplusparse->au_crc_mode == DABPLUS_AU_CRC_DROP);
+  use_list = dabplusparse->buffer_list;
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  status = gst_dabplusparse_superframe_header_compare_audio_params(
+    hdr, &dabplusparse->superframe_header);
+
+  dabplusparse->superframe_header = *hdr;
+
+  if (G_UNLIKELY (!status)) { /* if caps has changed */
+    GST_INFO_OBJECT (dabplusparse, "caps has changed");
+    GST_INFO_OBJECT (dabplusparse,
+      "superframe: dac rate: '%s', sbr '%s', aac channel mode: '%s', ps: '%s', surround cfg: %u",
+      hdr->dac_rate ? "48 kHz" : "32 kHz",
+      hdr->sbr_flag ? "on" : "off",
+      hdr->aac_channel_mode ? "stereo" : "mono",
+      hdr->ps_flag ? "on" : "off",
+      hdr->mpeg_surround_config);
+
+      gst_dabplusparse_get_audio_params (hdr, &dabplusparse->object_type,
+        &dabplusparse->sample_rate, &dabplusparse->channels);
+
+      /* superframes queued so far go out with the old caps */
+      gst_dabplusparse_emit_drain (dabplusparse);
+
+      if (!gst_dabplusparse_set_src_caps (dabplusparse)) {
+        /* If linking fails, we need to return appropriate error */
+        return GST_FLOW_NOT_LINKED;
+      }
+
+  }
+
+  if ((dabplusparse->o_header_type != DABPLUS_HEADER_ADTS) &&
+      (dabplusparse->o_header_type != DABPLUS_HEADER_LOAS) &&
+      (dabplusparse->o_header_type != DABPLUS_HEADER_RAW) &&
+      (dabplusparse->o_header_type != DABPLUS_HEADER_SUPERFRAME)) {
+    GST_ERROR_OBJECT (dabplusparse, "output type not negotiated");
+    return GST_FLOW_NOT_LINKED;
+  }
+
+  pts = gst_dabplusparse_superframe_pts (dabplusparse, frame);
+
+  gst_base_parse_add_index_entry (GST_BASE_PARSE (dabplusparse),
+    frame->offset, pts, TRUE, FALSE);
+  gst_dabplusparse_index_superframe (dabplusparse, frame, buffer, hdr, pts);
+
+  if (dabplusparse->emit_ring)
+    return gst_dabplusparse_queue_superframe (dabplusparse, frame, buffer, hdr,
+      pts, drop_corrupted, use_list);
+
+  if (dabplusparse->o_header_type == DABPLUS_HEADER_SUPERFRAME)
+    return gst_dabplusparse_push_superframe (dabplusparse, frame, buffer, hdr, pts);
+
+  if (use_list) {
+    list = gst_dabplusparse_make_au_list (dabplusparse, buffer, hdr, pts,
+      drop_corrupted, GST_BUFFER_FLAG_IS_SET (frame->buffer, GST_BUFFER_FLAG_DISCONT));
+    if (G_UNLIKELY (!list))
+      return GST_FLOW_ERROR;
+
+    /* Superframe itself is only consumed. This also makes base class
+     * push pending events (caps, segment) ahead of the list. */
+    frame->flags |= GST_BASE_PARSE_FRAME_FLAG_DROP;
+    ret = gst_base_parse_finish_frame (GST_BASE_PARSE (dabplusparse), frame,
+      dabplusparse->superframe_size);
+
+    if (ret == GST_FLOW_OK)
+      ret = gst_dabplusparse_push_list (dabplusparse, list, TRUE);
+    else
+      gst_buffer_list_unref (list);
+
+    return ret;
+  }
+
+  for(i = 0; i < hdr->num_aus; i = next) {
+    GstBaseParseFrame au_frame;
+    GstBuffer *au_buffer;
+
+    next = i + 1;
+
+    if (G_UNLIKELY (!hdr->au[i].crc_ok) && drop_corrupted) {
+      GST_DEBUG_OBJECT (dabplusparse, "dropping access unit %u", i);
+      continue;
+    }
+
+    au_buffer = gst_dabplusparse_make_output_buffer (dabplusparse, buffer,
+        hdr, i, drop_corrupted, &next);
+    if (G_UNLIKELY (!au_buffer))
+      return GST_FLOW_ERROR;
+
+    gst_dabplusparse_set_timestamps (hdr, au_buffer, pts, i, next);
+
+    gst_base_parse_frame_init (&au_frame);
+    au_frame.flags |= frame->flags;
+    au_frame.buffer = au_buffer;
+
+    ret = gst_base_parse_finish_frame (GST_BASE_PARSE (dabplusparse), &au_frame, 0);
+    if (ret != GST_FLOW_OK) {
+      GST_ERROR_OBJECT (dabplusparse,
+        "gst_base_parse_finish_frame() failed with code %d", ret);
+      return ret;
+    }
+  }
+
+  /* superframe itself is only consumed */
+  frame->flags |= GST_BASE_PARSE_FRAME_FLAG_DROP;
+  return gst_base_parse_finish_frame (GST_BASE_PARSE (dabplusparse), frame,
+    dabplusparse->superframe_size);
 }
 
 /**
- * gst_dabplusparse_get_audio_sampling_frequency_index:
- * @sample_rate: audio sampling rate.
+ * gst_dabplusparse_get_erasures:
+ * @dabplusparse: #GstDabPlusParse.
+ * @frame: #GstBaseParseFrame holding the superframe.
  *
- * Gets the Sampling Frequency Index value, as defined by table 1.18 in ISO/IEC
- * 14496-3, for a given sampling rate.
+ * Collects reliability hints of #GstDabPlusErasureMeta attached to the frame
+ * which describe bytes of the superframe.
  *
- * Returns: the Sampling Frequency Index value corresponding to @sample_rate,
- * if such a value exists; otherwise G_MAXUINT8.
+ * Returns: Array of dabplusparse->superframe_size erasure flags to be freed
+ *          with g_free(), or NULL if there are no erased bytes.
  */
-static guint8
-gst_dabplusparse_get_audio_sampling_frequency_index (gint sample_rate)
+static guint8 *
+gst_dabplusparse_get_erasures (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame)
 {
-  switch (sample_rate) {
-    case 96000:
-      return 0x0U;
-    case 88200:
-      return 0x1U;
-    case 64000:
-      return 0x2U;
-    case 48000:
-      return 0x3U;
-    case 44100:
-      return 0x4U;
-    case 32000:
-      return 0x5U;
-    case 24000:
-      return 0x6U;
-    case 22050:
-      return 0x7U;
-    case 16000:
-      return 0x8U;
-    case 12000:
-      return 0x9U;
-    case 11025:
-      return 0xAU;
-    case 8000:
-      return 0xBU;
-    case 7350:
-      return 0xCU;
-    default:
-      return G_MAXUINT8;
+  GstMeta *meta;
+  gpointer state = NULL;
+  guint8 *erasures = NULL;
+  guint threshold;
+  guint64 from, to, pos;
+
+  GST_OBJECT_LOCK (dabplusparse);
+  threshold = dabplusparse->erasure_threshold;
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  if (threshold == 0)
+    return NULL;
+
+  while ((meta = gst_buffer_iterate_meta_filtered (frame->buffer, &state,
+      GST_DABPLUS_ERASURE_META_API_TYPE))) {
+    const GstDabPlusErasureMeta *emeta = (const GstDabPlusErasureMeta *) meta;
+
+    from = MAX (emeta->offset, frame->offset);
+    to = MIN (emeta->offset + emeta->size, frame->offset + dabplusparse->superframe_size);
+
+    for (pos = from; pos < to; ++pos) {
+      if (emeta->reliability[pos - emeta->offset] < threshold) {
+        if (!erasures)
+          erasures = g_malloc0 (dabplusparse->superframe_size);
+        erasures[pos - frame->offset] = 1;
+      }
+    }
   }
+
+  return erasures;
 }
 
 /**
- * gst_dabplusparse_prepend_adts_headers:
+ * gst_dabplusparse_correct_superframe:
  * @dabplusparse: #GstDabPlusParse.
- * @frame: raw AAC frame to which ADTS headers shall be prepended.
+ * @frame: #GstBaseParseFrame holding the superframe.
+ * @data: Mapped data of the frame's buffer.
  *
- * Prepends ADTS headers to a raw AAC audio frame.
+ * Runs Reed-Solomon error correction over a superframe which failed
+ * the syndrome check, making use of erasure hints if there are any.
+ * Input buffers are not writable, thus corrections are made
+ * in a copy of the superframe.
  *
- * Returns: TRUE if ADTS headers were successfully prepended; FALSE otherwise.
+ * Returns: Buffer with corrected superframe (carrying metadata of the frame's
+ *          buffer), or NULL if nothing could be corrected.
  */
-static gboolean
-gst_dabplusparse_prepend_adts_headers (GstDabPlusParse * dabplusparse,
-    GstBaseParseFrame * frame)
+static GstBuffer *
+gst_dabplusparse_correct_superframe (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame, const guint8 * data)
 {
-  GstMemory *mem;
-  guint8 *adts_headers;
-  gsize buf_size;
-  gsize frame_size;
-  guint8 id, profile, channel_configuration, sampling_frequency_index;
+  GstBuffer *corrected;
+  guint8 *superframe;
+  guint8 *erasures;
+  guint count;
+  gboolean status;
 
-  id = 0x0U; /* MPEG4 */
-  profile = gst_dabplusparse_get_audio_profile_object_type (dabplusparse);
-  if (profile == G_MAXUINT8) {
-    GST_ERROR_OBJECT (dabplusparse, "unsupported audio profile or object type");
-    return FALSE;
-  }
-  channel_configuration =
-      gst_dabplusparse_get_audio_channel_configuration (dabplusparse->channels);
-  if (channel_configuration == G_MAXUINT8) {
-    GST_ERROR_OBJECT (dabplusparse, "unsupported number of channels");
-    return FALSE;
-  }
-  sampling_frequency_index =
-      gst_dabplusparse_get_audio_sampling_frequency_index (dabplusparse->sample_rate);
-  if (sampling_frequency_index == G_MAXUINT8) {
-    GST_ERROR_OBJECT (dabplusparse, "unsupported sampling frequency");
-    return FALSE;
+  superframe = g_malloc (dabplusparse->superframe_size);
+  memcpy (superframe, data, dabplusparse->superframe_size);
+
+  erasures = gst_dabplusparse_get_erasures (dabplusparse, frame);
+
+  status = gst_dabplus_rs_correct_superframe (superframe,
+    dabplusparse->superframe_size, erasures, &count);
+  if (!status)
+    GST_INFO_OBJECT (dabplusparse, "superframe contains uncorrectable errors");
+
+  if (count == 0) {
+    g_free (erasures);
+    g_free (superframe);
+    return NULL;
   }
 
-  frame->out_buffer = gst_buffer_copy (frame->buffer);
-  buf_size = gst_buffer_get_size (frame->out_buffer);
-  frame_size = buf_size + ADTS_HEADER_LENGTH;
+  GST_DEBUG_OBJECT (dabplusparse, "corrected %u bytes of superframe%s", count,
+    erasures ? " (using erasure hints)" : "");
 
-  if (G_UNLIKELY (frame_size >= 0x4000)) {
-    GST_ERROR_OBJECT (dabplusparse, "frame size is too big for adts");
-    return FALSE;
+  g_free (erasures);
+
+  corrected = gst_buffer_new_wrapped (superframe, dabplusparse->superframe_size);
+  gst_buffer_copy_into (corrected, frame->buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+
+  return corrected;
+}
+
+/**
+ * gst_dabplusparse_check_superframe:
+ * @dabplusparse: #GstDabPlusParse.
+ * @frame: #GstBaseParseFrame holding the superframe.
+ * @data: Superframe data.
+ * @check_crcs: Whether access units shall be verified against their CRC.
+ * @corrected: Set to the Reed-Solomon corrected superframe,
+ *             NULL if nothing was corrected.
+ * @hdr: Set to the parsed superframe header.
+ *
+ * Checks a superframe against its Reed-Solomon parity (correcting it
+ * if needed), its firecode, header and access unit CRCs.
+ * Nothing but the superframe size and properties is used here,
+ * so superframes can be checked by worker threads in parallel mode.
+ *
+ * Returns: TRUE if the superframe is valid.
+ */
+static gboolean
+gst_dabplusparse_check_superframe (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame, const guint8 * data, gboolean check_crcs,
+    GstBuffer ** corrected, GstDabPlusSuperframeHeader * hdr)
+{
+  GstMapInfo map;
+  gboolean status;
+
+  *corrected = NULL;
+
+  if (G_UNLIKELY (!gst_dabplus_rs_check_superframe (data, dabplusparse->superframe_size))) {
+    *corrected = gst_dabplusparse_correct_superframe (dabplusparse, frame, data);
+    if (*corrected) {
+      gst_buffer_map (*corrected, &map, GST_MAP_READ);
+      data = map.data;
+    }
   }
 
-  adts_headers = (guint8 *) g_malloc0 (ADTS_HEADER_LENGTH);
+  do {
+    status = gst_dabplus_crc_check_firecode (data);
+    if (G_UNLIKELY (!status)) {
+      GST_INFO_OBJECT (dabplusparse, "buffer doesn't contain valid frame");
+      break;
+    }
+
+    status = gst_dabplusparse_parse_superframe_header (hdr, data,
+      dabplusparse->superframe_size);
+    if (G_UNLIKELY (!status)) {
+      GST_INFO_OBJECT (dabplusparse, "cannot parse superframe header");
+      break;
+    }
 
-  /* Note: no error correction bits are added to the resulting ADTS frames */
-  adts_headers[0] = 0xFFU;
-  adts_headers[1] = 0xF0U | (id << 3) | 0x1U;
-  adts_headers[2] = (profile << 6) | (sampling_frequency_index << 2) | 0x2U |
-      (channel_configuration & 0x4U);
-  adts_headers[3] = ((channel_configuration & 0x3U) << 6) | 0x30U |
-      (guint8) (frame_size >> 11);
-  adts_headers[4] = (guint8) ((frame_size >> 3) & 0x00FF);
-  adts_headers[5] = (guint8) (((frame_size & 0x0007) << 5) + 0x1FU);
-  adts_headers[6] = 0xFCU;
+    if (check_crcs) {
+      guint n_errors = gst_dabplusparse_check_au_crcs (hdr, data);
+      if (G_UNLIKELY (n_errors))
+        GST_INFO_OBJECT (dabplusparse, "%u of %u access units with invalid crc",
+          n_errors, hdr->num_aus);
+    }
+  } while (0);
 
-  mem = gst_memory_new_wrapped (0, adts_headers, ADTS_HEADER_LENGTH, 0,
-      ADTS_HEADER_LENGTH, NULL, NULL);
-  gst_buffer_prepend_memory (frame->out_buffer, mem);
+  if (*corrected)
+    gst_buffer_unmap (*corrected, &map);
 
-  return TRUE;
+  return status;
 }
 
+/**
+ * gst_dabplusparse_check_job:
+ * @data: #GstDabPlusSuperframeJob to be done.
+ * @user_data: #GstDabPlusParse.
+ *
+ * Worker thread function of parallel mode.
+ *
+ * Returns: None.
+ */
 static void
-gst_dabplusparse_remove_fields (GstCaps * caps)
+gst_dabplusparse_check_job (gpointer data, gpointer user_data)
 {
-  guint i, n;
-
-  n = gst_caps_get_size (caps);
-  for (i = 0; i < n; i++) {
-    GstStructure *s = gst_caps_get_structure (caps, i);
-
-    gst_structure_remove_field (s, "framed");
-  }
+  GstDabPlusSuperframeJob *job = data;
+  GstDabPlusParse *dabplusparse = user_data;
+  gboolean valid;
+
+  valid = gst_dabplusparse_check_superframe (dabplusparse, &job->frame,
+    job->data, job->check_crcs, &job->corrected, &job->header);
+
+  g_mutex_lock (&dabplusparse->parallel_lock);
+  job->valid = valid;
+  job->done = TRUE;
+  g_cond_broadcast (&dabplusparse->parallel_cond);
+  g_mutex_unlock (&dabplusparse->parallel_lock);
 }
 
+/**
+ * gst_dabplusparse_wait_job:
+ * @dabplusparse: #GstDabPlusParse.
+ * @job: #GstDabPlusSuperframeJob.
+ *
+ * Waits until a worker thread is done with @job.
+ *
+ * Returns: None.
+ */
 static void
-gst_dabplusparse_add_conversion_fields (GstCaps * caps)
+gst_dabplusparse_wait_job (GstDabPlusParse * dabplusparse,
+    GstDabPlusSuperframeJob * job)
 {
-  guint i, n;
+  g_mutex_lock (&dabplusparse->parallel_lock);
+  while (!job->done)
+    g_cond_wait (&dabplusparse->parallel_cond, &dabplusparse->parallel_lock);
+  g_mutex_unlock (&dabplusparse->parallel_lock);
+}
 
-  n = gst_caps_get_size (caps);
-  for (i = 0; i < n; i++) {
-    GstStructure *s = gst_caps_get_structure (caps, i);
+/**
+ * gst_dabplusparse_handle_superframes:
+ * @dabplusparse: #GstDabPlusParse.
+ * @frame: #GstBaseParseFrame holding the superframes.
+ * @data: Mapped data of the frame's buffer.
+ * @avail: Size of @data.
+ * @check_crcs: Whether access units shall be verified against their CRC.
+ * @n_finished: Set to the number of superframes finished.
+ *
+ * Parallel mode: all complete superframes of the frame (but no more than
+ * DABPLUS_PARALLEL_SUPERFRAMES) are given to the worker threads at once.
+ * Meanwhile they are finished here in stream order, each one as soon as
+ * it has been checked. The first invalid superframe stops that, it is left
+ * for resynchronisation the usual way.
+ *
+ * Returns: a #GstFlowReturn.
+ */
+static GstFlowReturn
+gst_dabplusparse_handle_superframes (GstDabPlusParse * dabplusparse,
+    GstBaseParseFrame * frame, const guint8 * data, gsize avail,
+    gboolean check_crcs, guint * n_finished)
+{
+  GstDabPlusSuperframeJob *job;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint superframe_size = dabplusparse->superframe_size;
+  guint n = MIN (avail / superframe_size, DABPLUS_PARALLEL_SUPERFRAMES);
+  guint i;
 
-    if (gst_structure_has_field (s, "stream-format")) {
-      const GValue *v = gst_structure_get_value (s, "stream-format");
+  GST_LOG_OBJECT (dabplusparse, "checking %u superframes at offset %"
+    G_GUINT64_FORMAT, n, frame->offset);
 
-      if (G_VALUE_HOLDS_STRING (v)) {
-        const gchar *str = g_value_get_string (v);
+  for (i = 0; i < n; ++i) {
+    job = &dabplusparse->jobs[i];
 
-        if (strcmp (str, "adts") == 0 || strcmp (str, "raw") == 0) {
-          GValue va = G_VALUE_INIT;
-          GValue vs = G_VALUE_INIT;
+    /* superframe memory is shared, timestamps stay with the first one */
+    gst_base_parse_frame_init (&job->frame);
+    job->frame.buffer = gst_buffer_copy_region (frame->buffer,
+      GST_BUFFER_COPY_ALL, i * superframe_size, superframe_size);
+    job->frame.flags = frame->flags;
+    job->frame.offset = frame->offset + i * superframe_size;
+    if (i > 0)
+      GST_BUFFER_FLAG_UNSET (job->frame.buffer, GST_BUFFER_FLAG_DISCONT);
 
-          g_value_init (&va, GST_TYPE_LIST);
-          g_value_init (&vs, G_TYPE_STRING);
-          g_value_set_string (&vs, "adts");
-          gst_value_list_append_value (&va, &vs);
-          g_value_set_string (&vs, "raw");
-          gst_value_list_append_value (&va, &vs);
-          gst_structure_set_value (s, "stream-format", &va);
-          g_value_unset (&va);
-          g_value_unset (&vs);
-        }
-      } else if (GST_VALUE_HOLDS_LIST (v)) {
-        gboolean contains_raw = FALSE;
-        gboolean contains_adts = FALSE;
-        guint m = gst_value_list_get_size (v), j;
+    job->data = data + i * superframe_size;
+    job->check_crcs = check_crcs;
+    job->corrected = NULL;
+    job->valid = FALSE;
+    job->done = FALSE;
 
-        for (j = 0; j < m; j++) {
-          const GValue *ve = gst_value_list_get_value (v, j);
-          const gchar *str;
+    g_thread_pool_push (dabplusparse->workers, job, NULL);
+  }
 
-          if (G_VALUE_HOLDS_STRING (ve) && (str = g_value_get_string (ve))) {
-            if (strcmp (str, "adts") == 0)
-              contains_adts = TRUE;
-            else if (strcmp (str, "raw") == 0)
-              contains_raw = TRUE;
-          }
-        }
+  for (i = 0; (i < n) && (ret == GST_FLOW_OK); ++i) {
+    GstBuffer *superframe;
 
-        if (contains_adts || contains_raw) {
-          GValue va = G_VALUE_INIT;
-          GValue vs = G_VALUE_INIT;
+    job = &dabplusparse->jobs[i];
+    gst_dabplusparse_wait_job (dabplusparse, job);
 
-          g_value_init (&va, GST_TYPE_LIST);
-          g_value_init (&vs, G_TYPE_STRING);
-          g_value_copy (v, &va);
+    if (!job->valid)
+      break;
 
-          if (!contains_raw) {
-            g_value_set_string (&vs, "raw");
-            gst_value_list_append_value (&va, &vs);
-          }
-          if (!contains_adts) {
-            g_value_set_string (&vs, "adts");
-            gst_value_list_append_value (&va, &vs);
-          }
+    dabplusparse->sync_misses = 0;
+    dabplusparse->sync_offset = job->frame.offset % superframe_size;
+    gst_dabplusparse_keep_lookbehind (dabplusparse, job->frame.offset, job->data);
+
+    /* finishing the frame releases its buffer, unless it fails before that */
+    superframe = gst_buffer_ref (job->frame.buffer);
+    ret = gst_dabplusparse_finish_superframe (dabplusparse, &job->frame,
+      job->corrected ? job->corrected : superframe, &job->header);
+    if (job->frame.buffer == superframe)
+      gst_base_parse_frame_free (&job->frame);
+    gst_buffer_unref (superframe);
+    gst_buffer_replace (&job->corrected, NULL);
+  }
 
-          gst_structure_set_value (s, "stream-format", &va);
+  *n_finished = i;
 
-          g_value_unset (&vs);
-          g_value_unset (&va);
-        }
-      }
-    }
+  /* workers are not to be left with data which is about to go away */
+  for (; i < n; ++i) {
+    job = &dabplusparse->jobs[i];
+    gst_dabplusparse_wait_job (dabplusparse, job);
+    gst_buffer_replace (&job->corrected, NULL);
+    gst_base_parse_frame_free (&job->frame);
   }
+
+  return ret;
 }
 
 /**
- * gst_dabplusparse_start:
- * @baseparse: #GstBaseParse.
- *
- * Implementation of "start" vmethod in #GstBaseParse class.
+ * gst_dabplusparse_update_duration:
+ * @dabplusparse: #GstDabPlusParse.
  *
- * Returns: TRUE if startup succeeded.
+ * Once superframe size is known, stream bitrate is known exactly
+ * (superframe_size bytes per 120 ms) and so is the duration,
+ * provided upstream knows its size in bytes or there is an index.
  */
-static gboolean
-gst_dabplusparse_start (GstBaseParse * baseparse)
+static void
+gst_dabplusparse_update_duration (GstDabPlusParse * dabplusparse)
 {
-  GstDabPlusParse *dabplusparse;
+  GstBaseParse *baseparse = GST_BASE_PARSE (dabplusparse);
+  gint64 bytes;
+  GstClockTime duration;
+
+  gst_base_parse_set_average_bitrate (baseparse,
+    gst_util_uint64_scale (dabplusparse->superframe_size * 8, GST_SECOND,
+      SUPERFRAME_DURATION));
+
+  if (dabplusparse->index) {
+    GstDabPlusIndexEntry last;
+
+    if (gst_dabplus_index_get_entry (dabplusparse->index,
+        gst_dabplus_index_get_n_entries (dabplusparse->index) - 1, &last)) {
+      GST_INFO_OBJECT (dabplusparse, "duration: %" GST_TIME_FORMAT " (index)",
+        GST_TIME_ARGS (last.pts + SUPERFRAME_DURATION));
+      gst_base_parse_set_duration (baseparse, GST_FORMAT_TIME,
+        last.pts + SUPERFRAME_DURATION, 0);
+      return;
+    }
+  }
 
-  dabplusparse = GST_DABPLUSPARSE (baseparse);
+  if (!gst_pad_peer_query_duration (GST_BASE_PARSE_SINK_PAD (dabplusparse),
+      GST_FORMAT_BYTES, &bytes) || (bytes <= 0)) {
+    GST_DEBUG_OBJECT (dabplusparse, "upstream size unknown");
+    return;
+  }
 
-  GST_INFO_OBJECT (dabplusparse, "starting");
+  if (bytes <= dabplusparse->sync_offset)
+    return;
 
-  gst_dabplusparse_reset (dabplusparse);
+  duration = ((bytes - dabplusparse->sync_offset) / dabplusparse->superframe_size) *
+    SUPERFRAME_DURATION;
 
-  return TRUE;
+  GST_INFO_OBJECT (dabplusparse, "duration: %" GST_TIME_FORMAT " (%" G_GINT64_FORMAT " bytes)",
+    GST_TIME_ARGS (duration), bytes);
+
+  gst_base_parse_set_duration (baseparse, GST_FORMAT_TIME, duration, 0);
 }
 
 /**
- * gst_dabplusparse_stop:
+ * gst_dabplusparse_convert:
  * @baseparse: #GstBaseParse.
+ * @src_format: #GstFormat describing the source format.
+ * @src_value: Source value to be converted.
+ * @dest_format: #GstFormat defining the converted format.
+ * @dest_value: Pointer where the conversion result will be put.
  *
- * Implementation of "stop" vmethod in #GstBaseParse class.
+ * Implementation of "convert" vmethod in #GstBaseParse class.
+ * Once superframe size is known, bytes and time map exactly
+ * (superframe_size bytes per 120 ms, counted from where the superframes
+ * start), times being converted to the beginning of the superframe
+ * they fall in, so seeks land on superframe boundaries.
+ * With an index, superframe offsets and timestamps are taken from it,
+ * which also holds for recordings with gaps.
+ * Before that default (bitrate estimation based) conversion is used.
  *
- * Returns: TRUE if stopping succeeded.
+ * Returns: TRUE if conversion was successful.
  */
 static gboolean
-gst_dabplusparse_stop (GstBaseParse * baseparse)
+gst_dabplusparse_convert (GstBaseParse * baseparse, GstFormat src_format,
+    gint64 src_value, GstFormat dest_format, gint64 * dest_value)
 {
-  GstDabPlusParse *dabplusparse;
+  GstDabPlusParse *dabplusparse = GST_DABPLUSPARSE (baseparse);
+  guint superframe_size = dabplusparse->superframe_size;
+  guint64 sync_offset = dabplusparse->sync_offset;
+  GstDabPlusIndex *index;
+  gboolean found = FALSE;
+
+  if (sync_offset == G_MAXUINT64)
+    sync_offset = 0;
+
+  /* called from seek and query handlers, the streaming thread may close
+     the index meanwhile */
+  GST_OBJECT_LOCK (dabplusparse);
+  index = dabplusparse->index ? gst_dabplus_index_ref (dabplusparse->index) : NULL;
+  GST_OBJECT_UNLOCK (dabplusparse);
+
+  if (index && (src_value >= 0) && (src_format != dest_format)) {
+    GstDabPlusIndexEntry entry;
+
+    if ((src_format == GST_FORMAT_BYTES) && (dest_format == GST_FORMAT_TIME) &&
+        gst_dabplus_index_find_by_offset (index, src_value, &entry)) {
+      guint64 within = ((guint64) src_value > entry.offset) ?
+        MIN ((guint64) src_value - entry.offset,
+          gst_dabplus_index_get_superframe_size (index)) : 0;
+      *dest_value = entry.pts + gst_util_uint64_scale (within, SUPERFRAME_DURATION,
+        gst_dabplus_index_get_superframe_size (index));
+      found = TRUE;
+    } else if ((src_format == GST_FORMAT_TIME) && (dest_format == GST_FORMAT_BYTES) &&
+        gst_dabplus_index_find_by_time (index, src_value, &entry)) {
+      *dest_value = entry.offset;
+      found = TRUE;
+    }
+  }
 
-  dabplusparse = GST_DABPLUSPARSE (baseparse);
+  if (index)
+    gst_dabplus_index_unref (index);
 
-  GST_INFO_OBJECT (dabplusparse, "stopping");
+  if (found)
+    return TRUE;
 
-  return TRUE;
+  if ((superframe_size == 0) || (src_value < 0))
+    return gst_base_parse_convert_default (baseparse, src_format, src_value,
+      dest_format, dest_value);
+
+  if (src_format == dest_format) {
+    *dest_value = src_value;
+    return TRUE;
+  }
+
+  if ((src_format == GST_FORMAT_BYTES) && (dest_format == GST_FORMAT_TIME)) {
+    *dest_value = ((guint64) src_value > sync_offset) ?
+      gst_util_uint64_scale (src_value - sync_offset, SUPERFRAME_DURATION,
+        superframe_size) : 0;
+    return TRUE;
+  }
+
+  if ((src_format == GST_FORMAT_TIME) && (dest_format == GST_FORMAT_BYTES)) {
+    *dest_value = sync_offset + (src_value / SUPERFRAME_DURATION) * superframe_size;
+    return TRUE;
+  }
+
+  return gst_base_parse_convert_default (baseparse, src_format, src_value,
+    dest_format, dest_value);
 }
 
 /**
- * gst_dabplusparse_sink_getcaps:
+ * gst_dabplusparse_sink_event:
  * @baseparse: #GstBaseParse.
- * @filter: #GstCaps
+ * @event: #GstEvent.
  *
- * Implementation of "get_sink_caps" vmethod in #GstBaseParse class.
+ * Implementation of "sink_event" vmethod in #GstBaseParse class.
+ * The index being written is completed at EOS, a flush (seek) before
+ * means it would not cover the whole recording, so it is abandoned.
+ * A flush or a new BYTES segment also arms snapping to the next superframe
+ * boundary.
+ * Serialized events wait for superframes queued for the emission thread.
  *
- * Returns: Our resulting #GstCaps.
+ * Returns: TRUE if the event was handled.
  */
-static GstCaps *
-gst_dabplusparse_sink_getcaps (GstBaseParse *baseparse, GstCaps *filter)
+static gboolean
+gst_dabplusparse_sink_event (GstBaseParse * baseparse, GstEvent * event)
 {
-  GstCaps *peercaps, *templ;
-  GstCaps *res;
-  GstDabPlusParse *dabplusparse;
-
-  dabplusparse = GST_DABPLUSPARSE (baseparse);
-
-  GST_INFO_OBJECT (dabplusparse, "filter caps: %" GST_PTR_FORMAT, filter);
-
-  templ = gst_pad_get_pad_template_caps (GST_BASE_PARSE_SINK_PAD (baseparse));
-
-  if (filter) {
-    GstCaps *fcopy = gst_caps_copy (filter);
-    /* Remove the fields we convert */
-    gst_dabplusparse_remove_fields (fcopy);
-    gst_dabplusparse_add_conversion_fields (fcopy);
-    peercaps = gst_pad_peer_query_caps (GST_BASE_PARSE_SRC_PAD (baseparse), fcopy);
-    gst_caps_unref (fcopy);
-  } else
-    peercaps = gst_pad_peer_query_caps (GST_BASE_PARSE_SRC_PAD (baseparse), NULL);
-
-  if (peercaps) {
-    /* Remove the fields we convert */
-    peercaps = gst_caps_make_writable (peercaps);
-    gst_dabplusparse_remove_fields (peercaps);
-    gst_dabplusparse_add_conversion_fields (peercaps);
-
-    res = gst_caps_intersect_full (peercaps, templ, GST_CAPS_INTERSECT_FIRST);
-    gst_caps_unref (peercaps);
-    gst_caps_unref (templ);
-  } else {
-    res = templ;
-  }
-
-  if (filter) {
-    GstCaps *intersection;
+  GstDabPlusParse *dabplusparse = GST_DABPLUSPARSE (baseparse);
+
+  /* the base class takes over segments right away, superframes queued
+     before have to be clipped against the one they belong to */
+  if (GST_EVENT_IS_SERIALIZED (event))
+    gst_dabplusparse_emit_drain (dabplusparse);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      dabplusparse->snap_pending = TRUE;
+      if (dabplusparse->index_writing)
+        gst_dabplusparse_close_index (dabplusparse, FALSE);
+      break;
+    case GST_EVENT_SEGMENT: {
+      const GstSegment *segment;
 
-    intersection =
-        gst_caps_intersect_full (filter, res, GST_CAPS_INTERSECT_FIRST);
-    gst_caps_unref (res);
-    res = intersection;
+      gst_event_parse_segment (event, &segment);
+      if (segment->format == GST_FORMAT_BYTES)
+        dabplusparse->snap_pending = TRUE;
+      break;
+    }
+    case GST_EVENT_EOS:
+      if (dabplusparse->index_writer) {
+        GST_INFO_OBJECT (dabplusparse, "recording indexed");
+        gst_dabplusparse_close_index (dabplusparse, TRUE);
+      }
+      break;
+    default:
+      break;
   }
 
-  GST_INFO_OBJECT (dabplusparse, "res caps: %" GST_PTR_FORMAT, res);
-
-  return res;
+  return GST_BASE_PARSE_CLASS (gst_dabplusparse_parent_class)->sink_event (
+    baseparse, event);
 }
 
 /**
@@ -867,12 +3694,19 @@ gst_dabplusparse_handle_frame (GstBaseParse *baseparse,
   GstDabPlusParse *dabplusparse;
   GstDabPlusSuperframeHeader superframe_header;
   gboolean status;
+  gboolean check_crcs;
+  GstFlowReturn ret;
   GstBuffer *buffer;
-  guint i;
+  GstBuffer *corrected = NULL;
 
   dabplusparse = GST_DABPLUSPARSE (baseparse);
   *skipsize = 0;
 
+  if (G_UNLIKELY (dabplusparse->index_pending)) {
+    dabplusparse->index_pending = FALSE;
+    gst_dabplusparse_open_index (dabplusparse);
+  }
+
   /* need to save buffer from invalidation upon _finish_frame */
   buffer = frame->buffer;
   gst_buffer_map (buffer, &map, GST_MAP_READ);
@@ -887,124 +3721,94 @@ gst_dabplusparse_handle_frame (GstBaseParse *baseparse,
 
       dabplusparse->i_header_type = DABPLUS_HEADER_SUPERFRAME;
       dabplusparse->o_header_type = DABPLUS_HEADER_ADTS;
+
+      dabplusparse->sync_offset =
+        (frame->offset + *skipsize) % dabplusparse->superframe_size;
+      gst_dabplusparse_update_duration (dabplusparse);
+
+      if (dabplusparse->workers)
+        gst_base_parse_set_min_frame_size (baseparse,
+          DABPLUS_PARALLEL_SUPERFRAMES * dabplusparse->superframe_size);
+
+      /* first superframe is further in the data, skip to it first */
+      if (*skipsize) {
+        status = FALSE;
+        break;
+      }
+    }
+
+    if (G_UNLIKELY (dabplusparse->snap_pending)) {
+      dabplusparse->snap_pending = FALSE;
+
+      /* after a seek go straight to the superframe boundary, which is known
+         from the superframe size and where superframes started before
+         (seeks based on the index land on superframes anyway). Other
+         discontinuities (lost data) don't keep alignment, they are left
+         to resynchronisation. */
+      if ((dabplusparse->sync_offset != G_MAXUINT64) && !dabplusparse->index) {
+        guint misalignment = (frame->offset + dabplusparse->superframe_size -
+          dabplusparse->sync_offset) % dabplusparse->superframe_size;
+        if (misalignment) {
+          GST_DEBUG_OBJECT (dabplusparse, "seek to offset %" G_GUINT64_FORMAT
+            ", skipping %u bytes to superframe boundary", frame->offset,
+            dabplusparse->superframe_size - misalignment);
+          *skipsize = dabplusparse->superframe_size - misalignment;
+          status = FALSE;
+          break;
+        }
+      }
     }
 
     status = (map.size >= dabplusparse->superframe_size);
     if (G_UNLIKELY (!status)) {
+      /* superframe size may be known before we have got the whole superframe */
       GST_INFO_OBJECT (dabplusparse, "buffer doesn't contain enough data");
-      if (!GST_BASE_PARSE_DRAINING (baseparse))
-        return GST_FLOW_ERROR;
       break;
     }
 
-    status = gst_dabplusparse_check_firecode (map.data);
-    if (G_UNLIKELY (!status)) {
-      GST_INFO_OBJECT (dabplusparse, "buffer doesn't contain valid frame");
-      gst_dabplusparse_reset (dabplusparse);
-      break;
+    GST_OBJECT_LOCK (dabplusparse);
+    check_crcs = (dabplusparse->au_crc_mode != DABPLUS_AU_CRC_PASS);
+    GST_OBJECT_UNLOCK (dabplusparse);
+
+    if (dabplusparse->workers && (map.size >= 2 * dabplusparse->superframe_size)) {
+      guint n_finished;
+
+      ret = gst_dabplusparse_handle_superframes (dabplusparse, frame,
+        map.data, map.size, check_crcs, &n_finished);
+      if ((ret != GST_FLOW_OK) || (n_finished > 0)) {
+        gst_buffer_unmap (buffer, &map);
+        return ret;
+      }
+      /* first superframe is invalid, resynchronise as below */
     }
 
-    status = gst_dabplusparse_parse_superframe_header (
-      &superframe_header, map.data, dabplusparse->superframe_size);
+    status = gst_dabplusparse_check_superframe (dabplusparse, frame, map.data,
+      check_crcs, &corrected, &superframe_header);
     if (G_UNLIKELY (!status)) {
-      GST_INFO_OBJECT (dabplusparse, "cannot parse superframe header");
-      gst_dabplusparse_reset (dabplusparse);
+      gst_dabplusparse_resync (dabplusparse, frame->offset, map.data, map.size,
+        skipsize);
       break;
     }
 
+    dabplusparse->sync_misses = 0;
+    dabplusparse->sync_offset = frame->offset % dabplusparse->superframe_size;
+    gst_dabplusparse_keep_lookbehind (dabplusparse, frame->offset, map.data);
+
   } while (0);
 
   gst_buffer_unmap (buffer, &map);
 
-  if (G_UNLIKELY (!status))
+  if (G_UNLIKELY (!status)) {
+    if (corrected)
+      gst_buffer_unref (corrected);
     return GST_FLOW_OK;
-
-  status = gst_dabplusparse_superframe_header_compare_audio_params(
-    &superframe_header, &dabplusparse->superframe_header);
-
-  dabplusparse->superframe_header = superframe_header;
-
-  if (G_UNLIKELY (!status)) { /* if caps has changed */
-    const GstDabPlusSuperframeHeader *hdr = &superframe_header;
-
-    GST_INFO_OBJECT (dabplusparse, "caps has changed");
-    GST_INFO_OBJECT (dabplusparse,
-      "superframe: dac rate: '%s', sbr '%s', aac channel mode: '%s', ps: '%s', surround cfg: %u",
-      hdr->dac_rate ? "48 kHz" : "32 kHz",
-      hdr->sbr_flag ? "on" : "off",
-      hdr->aac_channel_mode ? "stereo" : "mono",
-      hdr->ps_flag ? "on" : "off",
-      hdr->mpeg_surround_config);
-
-      if (hdr->sbr_flag)
-        dabplusparse->object_type = 1 /*5*/;
-      else
-        dabplusparse->object_type = 1;
-
-      if (hdr->dac_rate) {
-        dabplusparse->sample_rate = hdr->sbr_flag ? 24000 : 48000;
-      } else {
-        dabplusparse->sample_rate = hdr->sbr_flag ? 16000 : 32000;
-      }
-
-      if (hdr->mpeg_surround_config > 0) {
-        switch (hdr->mpeg_surround_config)
-        {
-          case 1:
-            /* MPEG Surround with 5.1 output channels is used */
-            dabplusparse->channels = 6;
-            break;
-          case 2:
-            /* MPEG Surround with 7.1 output channels is used */
-            dabplusparse->channels = 8;
-            break;
-          default:
-            dabplusparse->channels = 0;
-            break;
-        }
-      } else
-        dabplusparse->channels = hdr->aac_channel_mode + 1;
-
-      if (!gst_dabplusparse_set_src_caps (dabplusparse)) {
-        /* If linking fails, we need to return appropriate error */
-        return GST_FLOW_NOT_LINKED;
-      }
-
-      //gst_base_parse_set_frame_rate (baseparse, dabplusparse->sample_rate, 1024, 2, 2);
-  }
-
-  if ((dabplusparse->o_header_type != DABPLUS_HEADER_ADTS) &&
-      (dabplusparse->o_header_type != DABPLUS_HEADER_RAW)) {
-    GST_ERROR_OBJECT (dabplusparse, "output type not negotiated");
-    return GST_FLOW_NOT_LINKED;
   }
 
-  for(i = 0; i < superframe_header.num_aus; ++i) {
-    GstBaseParseFrame au_frame;
-    GstFlowReturn ret;
-
-    gst_base_parse_frame_init (&au_frame);
-    au_frame.flags |= frame->flags;
-    au_frame.buffer = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL,
-        superframe_header.au[i].start, superframe_header.au[i].size);
-    GST_BUFFER_FLAG_UNSET(au_frame.buffer, GST_BUFFER_FLAG_DISCONT);
-
-    if (dabplusparse->o_header_type == DABPLUS_HEADER_ADTS) {
-      if (!gst_dabplusparse_prepend_adts_headers (dabplusparse, &au_frame)) {
-        GST_ERROR_OBJECT (dabplusparse, "failed to prepend adts headers to frame");
-        return GST_FLOW_ERROR;
-      }
-    } else
-      au_frame.out_buffer = gst_buffer_copy (au_frame.buffer);
+  ret = gst_dabplusparse_finish_superframe (dabplusparse, frame,
+    corrected ? corrected : buffer, &superframe_header);
 
-    ret = gst_base_parse_finish_frame (baseparse, &au_frame, 0);
-    if (ret != GST_FLOW_OK) {
-      GST_ERROR_OBJECT (dabplusparse,
-        "gst_base_parse_finish_frame() failed with code %d", ret);
-      return ret;
-    }
-  }
+  if (corrected)
+    gst_buffer_unref (corrected);
 
-  frame->flags |= GST_BASE_PARSE_FRAME_FLAG_DROP;
-  return gst_base_parse_finish_frame (baseparse, frame, dabplusparse->superframe_size);
+  return ret;
 }
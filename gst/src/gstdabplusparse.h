@@ -24,6 +24,9 @@
 #include <gst/gst.h>
 #include <gst/base/gstbaseparse.h>
 
+#include "gstdabplusindex.h"
+#include "gstdabplusring.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_DABPLUSPARSE            (gst_dabplusparse_get_type())
@@ -39,9 +42,25 @@ typedef enum {
   DABPLUS_HEADER_UNKNOWN,
   DABPLUS_HEADER_SUPERFRAME,
   DABPLUS_HEADER_RAW,
-  DABPLUS_HEADER_ADTS
+  DABPLUS_HEADER_ADTS,
+  DABPLUS_HEADER_LOAS
 } GstDabPlusHeaderType;
 
+/**
+ * GstDabPlusAuCrcMode:
+ * @DABPLUS_AU_CRC_PASS: Access units with invalid CRC are pushed unchanged.
+ * @DABPLUS_AU_CRC_FLAG: Access units with invalid CRC are pushed with
+ *                       GST_BUFFER_FLAG_CORRUPTED set.
+ * @DABPLUS_AU_CRC_DROP: Access units with invalid CRC are dropped.
+ *
+ * What to do with access units which fail CRC verification.
+ */
+typedef enum {
+  DABPLUS_AU_CRC_PASS,
+  DABPLUS_AU_CRC_FLAG,
+  DABPLUS_AU_CRC_DROP
+} GstDabPlusAuCrcMode;
+
 typedef struct {
   guint header_firecode;
   guint rfa;
@@ -54,9 +73,43 @@ typedef struct {
   struct {
     guint start;
     guint size;
+    gboolean crc_ok;
   } au[6];
 } GstDabPlusSuperframeHeader;
 
+#define DABPLUS_RESYNC_PROBE_RANGE   32 /* How far around the expected offset
+                                          a superframe header is looked for */
+#define DABPLUS_SINK_CAPS_CACHE_SIZE 4
+#define DABPLUS_SRC_CAPS_CACHE_SIZE  16 /* dac rate x sbr x aac channel mode x ps */
+#define DABPLUS_PARALLEL_SUPERFRAMES 32 /* superframes checked at once in parallel mode */
+
+typedef struct {
+  GstCaps *filter; /* caps query filter, NULL if none */
+  guint cookie;    /* caps_cookie at the time 'caps' were computed */
+  GstCaps *caps;
+} GstDabPlusCapsCacheEntry;
+
+/* Superframe checked by a worker thread in parallel mode */
+typedef struct {
+  GstBaseParseFrame frame;           /* frame of this superframe only */
+  const guint8 *data;                /* superframe_size bytes */
+  gboolean check_crcs;
+  GstBuffer *corrected;              /* Reed-Solomon corrected copy, if any */
+  GstDabPlusSuperframeHeader header;
+  gboolean valid;
+  gboolean done;                     /* protected by parallel_lock */
+} GstDabPlusSuperframeJob;
+
+/* Validated superframe handed over to the emission thread */
+typedef struct {
+  GstBuffer *superframe;             /* superframe_size bytes */
+  GstDabPlusSuperframeHeader header;
+  GstClockTime pts;
+  gboolean discont;
+  gboolean drop_corrupted;
+  gboolean use_list;
+} GstDabPlusSuperframeDesc;
+
 typedef struct _GstDabPlusParse      GstDabPlusParse;
 typedef struct _GstDabPlusParseClass GstDabPlusParseClass;
 
@@ -76,8 +129,95 @@ struct _GstDabPlusParse {
   GstDabPlusHeaderType i_header_type;
   GstDabPlusHeaderType o_header_type;
 
+  /* ADTS header computed at caps negotiation, only frame length is patched per AU */
+  guint8 adts_header[7];
+  gboolean adts_header_valid;
+
+  /* AudioSpecificConfig carried by LOAS StreamMuxConfig */
+  guint16 audio_specific_config;
+
   guint superframe_size;
+  guint sync_confidence; /* percentage of headers consistent with superframe_size,
+                           protected by the object lock */
   GstDabPlusSuperframeHeader superframe_header;
+
+  /* Number of bytes searched for the second superframe header during detection */
+  guint detect_window;
+
+  /* Superframe size known in advance, 0 if it has to be detected */
+  guint configured_superframe_size; /* set by "superframe-size" or "bitrate" property */
+  guint caps_superframe_size;       /* announced in sink caps */
+
+  /* Consecutive superframes without valid header and how many of them we tolerate */
+  guint sync_misses;
+  guint max_sync_misses;
+
+  /* Byte offset of superframes modulo superframe_size, G_MAXUINT64 if unknown */
+  guint64 sync_offset;
+  gboolean snap_pending; /* after a flushing seek or a new BYTES segment */
+
+  /* Last bytes of the previous superframe (already consumed), so that
+     resynchronisation can look behind the expected offset as well */
+  guint8 lookbehind[DABPLUS_RESYNC_PROBE_RANGE];
+  guint64 lookbehind_offset; /* offset right after them, G_MAXUINT64 if none */
+
+  /* Bytes less reliable than that are passed as erasures to Reed-Solomon decoding */
+  guint erasure_threshold;
+
+  GstDabPlusAuCrcMode au_crc_mode;
+
+  /* Output buffers, see GstDabPlusAuPool */
+  GstBufferPool *pool;
+
+  /* Push access units of a superframe as one GstBufferList */
+  gboolean buffer_list;
+
+  GstClockTime next_pts; /* expected timestamp of the next superframe */
+  guint64 next_offset;   /* and its expected byte offset */
+
+  /* Sidecar index, see GstDabPlusIndex. The index is set and cleared
+     under the object lock, convert() references it from other threads. */
+  gchar *index_location;
+  GstDabPlusIndex *index;              /* complete index used for seeking */
+  GstDabPlusIndexWriter *index_writer; /* or the one being written */
+  gboolean index_writing;
+  gboolean index_pending; /* opened with the first data */
+
+  /* Memoized sink_getcaps results, bumping caps_cookie invalidates them
+     (reconfiguration, relinking of the source pad, start and stop) */
+  GstDabPlusCapsCacheEntry sink_caps_cache[DABPLUS_SINK_CAPS_CACHE_SIZE];
+  guint sink_caps_cache_next;
+  guint caps_cookie;
+
+  /* Src caps precomputed for every audio parameter combination in the
+     negotiated output format, NULL where downstream doesn't accept them */
+  GstCaps *src_caps_cache[DABPLUS_SRC_CAPS_CACHE_SIZE];
+  GstDabPlusHeaderType src_caps_cache_type; /* DABPLUS_HEADER_NOT_PARSED - empty */
+  guint src_caps_cache_cookie;
+
+  /* Parallel mode: superframes are checked by 'workers' and pushed in order
+     from the 'jobs' reorder buffer as soon as each of them is done */
+  gboolean parallel;
+  GThreadPool *workers;
+  GMutex parallel_lock;
+  GCond parallel_cond;
+  GstDabPlusSuperframeJob jobs[DABPLUS_PARALLEL_SUPERFRAMES];
+
+  /* Emission stage: superframes validated by the streaming thread are passed
+     through 'emit_ring' to 'emit_thread' which pushes them downstream */
+  guint pipeline_depth;
+  guint emit_depth;      /* pipeline_depth at start, 0 - no emission thread */
+  GstDabPlusRing *emit_ring;
+  GThread *emit_thread;
+  gulong emit_probe;
+  GMutex emit_lock;
+  GCond emit_cond;
+  gint emit_waiting;     /* threads sleeping on emit_cond */
+  guint emit_queued;     /* superframes queued by the streaming thread */
+  guint emit_done;       /* superframes pushed (or dropped) by emit_thread */
+  gint emit_flow;        /* failed flow return of emit_thread */
+  gint emit_flushing;
+  gint emit_stopping;
 };
 
 /**
@@ -0,0 +1,157 @@
+/* GStreamer DAB Plus access unit buffer pool
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstdabpluspool.h"
+
+G_DEFINE_TYPE (GstDabPlusAuPool, gst_dabplus_au_pool, GST_TYPE_BUFFER_POOL);
+
+static gboolean
+gst_dabplus_au_pool_set_config (GstBufferPool * pool, GstStructure * config)
+{
+  GstDabPlusAuPool *aupool = GST_DABPLUS_AU_POOL (pool);
+  guint size;
+
+  if (!gst_buffer_pool_config_get_params (config, NULL, &size, NULL, NULL))
+    return FALSE;
+
+  aupool->size = size;
+
+  return GST_BUFFER_POOL_CLASS (gst_dabplus_au_pool_parent_class)->set_config (
+      pool, config);
+}
+
+static gboolean
+gst_dabplus_au_pool_start (GstBufferPool * pool)
+{
+  GstDabPlusAuPool *aupool = GST_DABPLUS_AU_POOL (pool);
+
+  if (!GST_BUFFER_POOL_CLASS (gst_dabplus_au_pool_parent_class)->start (pool))
+    return FALSE;
+
+  /* preallocated buffers are not misses */
+  g_atomic_int_set (&aupool->acquired, 0);
+  g_atomic_int_set (&aupool->allocated, 0);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_dabplus_au_pool_alloc_buffer (GstBufferPool * pool, GstBuffer ** buffer,
+    GstBufferPoolAcquireParams * params)
+{
+  GstDabPlusAuPool *aupool = GST_DABPLUS_AU_POOL (pool);
+  GstFlowReturn ret;
+
+  ret = GST_BUFFER_POOL_CLASS (gst_dabplus_au_pool_parent_class)->alloc_buffer (
+      pool, buffer, params);
+  if (ret == GST_FLOW_OK)
+    g_atomic_int_inc (&aupool->allocated);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_dabplus_au_pool_acquire_buffer (GstBufferPool * pool, GstBuffer ** buffer,
+    GstBufferPoolAcquireParams * params)
+{
+  GstDabPlusAuPool *aupool = GST_DABPLUS_AU_POOL (pool);
+  GstFlowReturn ret;
+
+  ret = GST_BUFFER_POOL_CLASS (gst_dabplus_au_pool_parent_class)->acquire_buffer (
+      pool, buffer, params);
+  if (ret == GST_FLOW_OK)
+    g_atomic_int_inc (&aupool->acquired);
+
+  return ret;
+}
+
+static void
+gst_dabplus_au_pool_reset_buffer (GstBufferPool * pool, GstBuffer * buffer)
+{
+  GstDabPlusAuPool *aupool = GST_DABPLUS_AU_POOL (pool);
+  guint own = aupool->size ? 1 : 0;
+
+  /* drop memory borrowed from the superframe and restore our own */
+  if (gst_buffer_n_memory (buffer) > own)
+    gst_buffer_remove_memory_range (buffer, own, -1);
+  gst_buffer_set_size (buffer, aupool->size);
+
+  /* removing foreign memory does not make the buffer unusable for the pool */
+  GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_TAG_MEMORY);
+
+  GST_BUFFER_POOL_CLASS (gst_dabplus_au_pool_parent_class)->reset_buffer (
+      pool, buffer);
+}
+
+static void
+gst_dabplus_au_pool_class_init (GstDabPlusAuPoolClass * klass)
+{
+  GstBufferPoolClass *pool_class = GST_BUFFER_POOL_CLASS (klass);
+
+  pool_class->set_config = gst_dabplus_au_pool_set_config;
+  pool_class->start = gst_dabplus_au_pool_start;
+  pool_class->alloc_buffer = gst_dabplus_au_pool_alloc_buffer;
+  pool_class->acquire_buffer = gst_dabplus_au_pool_acquire_buffer;
+  pool_class->reset_buffer = gst_dabplus_au_pool_reset_buffer;
+}
+
+static void
+gst_dabplus_au_pool_init (GstDabPlusAuPool * pool)
+{
+  pool->size = 0;
+  pool->acquired = 0;
+  pool->allocated = 0;
+}
+
+/**
+ * gst_dabplus_au_pool_new:
+ *
+ * Creates a new, not yet configured, #GstDabPlusAuPool.
+ *
+ * Returns: The new pool.
+ */
+GstBufferPool *
+gst_dabplus_au_pool_new (void)
+{
+  return GST_BUFFER_POOL (g_object_new (GST_TYPE_DABPLUS_AU_POOL, NULL));
+}
+
+/**
+ * gst_dabplus_au_pool_get_stats:
+ * @pool: #GstDabPlusAuPool.
+ * @hits: Set to the number of buffers served from the pool.
+ * @misses: Set to the number of buffers which had to be allocated.
+ *
+ * Gets pool usage statistics since the pool was last activated.
+ */
+void
+gst_dabplus_au_pool_get_stats (GstDabPlusAuPool * pool, guint * hits,
+    guint * misses)
+{
+  guint acquired = g_atomic_int_get (&pool->acquired);
+  guint allocated = g_atomic_int_get (&pool->allocated);
+
+  *misses = MIN (allocated, acquired);
+  *hits = acquired - *misses;
+}
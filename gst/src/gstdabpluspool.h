@@ -0,0 +1,72 @@
+/* GStreamer DAB Plus access unit buffer pool
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DABPLUSPOOL_H__
+#define __GST_DABPLUSPOOL_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_DABPLUS_AU_POOL      (gst_dabplus_au_pool_get_type())
+#define GST_DABPLUS_AU_POOL(obj)      (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_DABPLUS_AU_POOL, GstDabPlusAuPool))
+#define GST_IS_DABPLUS_AU_POOL(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_DABPLUS_AU_POOL))
+
+typedef struct _GstDabPlusAuPool      GstDabPlusAuPool;
+typedef struct _GstDabPlusAuPoolClass GstDabPlusAuPoolClass;
+
+/**
+ * GstDabPlusAuPool:
+ *
+ * Pool of output buffers for the parser. Pooled buffers own only the memory
+ * configured as the pool's buffer size (room for an ADTS header or a LOAS
+ * frame, nothing for raw access units). Access unit memory borrowed from
+ * the superframe is appended while in use and removed again when the buffer
+ * returns to the pool, so buffers keep being recycled.
+ */
+struct _GstDabPlusAuPool {
+  GstBufferPool bufferpool;
+
+  /* Size of the memory owned by pooled buffers */
+  guint size;
+
+  /* Buffers acquired and buffers which had to be allocated for that */
+  gint acquired;
+  gint allocated;
+};
+
+/**
+ * GstDabPlusAuPoolClass:
+ * @parent_class: Parent class.
+ */
+struct _GstDabPlusAuPoolClass {
+  GstBufferPoolClass parent_class;
+};
+
+GType gst_dabplus_au_pool_get_type (void);
+
+GstBufferPool *gst_dabplus_au_pool_new (void);
+
+void gst_dabplus_au_pool_get_stats (GstDabPlusAuPool * pool,
+    guint * hits, guint * misses);
+
+G_END_DECLS
+
+#endif /* __GST_DABPLUSPOOL_H__ */
@@ -0,0 +1,133 @@
+/* GStreamer DAB Plus single producer, single consumer ring
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Fixed size ring of pointers passed from exactly one producer thread
+ * to exactly one consumer thread without locking. Only the producer
+ * writes 'head' and only the consumer writes 'tail'; both are free running
+ * counters, published with (full barrier) atomic stores after the slot
+ * they refer to has been written or read.
+ * Waiting for items or free slots is left to the users of the ring.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstdabplusring.h"
+
+struct _GstDabPlusRing {
+  gpointer *slots;
+  guint mask;  /* number of slots - 1 */
+
+  guint head;  /* slots written so far, producer only */
+  guint tail;  /* slots read so far, consumer only */
+};
+
+/**
+ * gst_dabplus_ring_new:
+ * @size: Minimum number of items the ring shall hold.
+ *
+ * Creates an empty ring, @size is rounded up to the next power of two.
+ *
+ * Returns: New #GstDabPlusRing to be freed with gst_dabplus_ring_free().
+ */
+GstDabPlusRing *
+gst_dabplus_ring_new (guint size)
+{
+  GstDabPlusRing *ring;
+  guint n = 1;
+
+  while (n < size)
+    n <<= 1;
+
+  ring = g_new0 (GstDabPlusRing, 1);
+  ring->slots = g_new0 (gpointer, n);
+  ring->mask = n - 1;
+
+  return ring;
+}
+
+/**
+ * gst_dabplus_ring_free:
+ * @ring: #GstDabPlusRing.
+ *
+ * Frees the ring, items still in it are not touched.
+ *
+ * Returns: None.
+ */
+void
+gst_dabplus_ring_free (GstDabPlusRing * ring)
+{
+  if (!ring)
+    return;
+
+  g_free (ring->slots);
+  g_free (ring);
+}
+
+/**
+ * gst_dabplus_ring_push:
+ * @ring: #GstDabPlusRing.
+ * @item: Item to be added, must not be NULL.
+ *
+ * Adds an item at the end of the ring. To be called by the producer only.
+ *
+ * Returns: FALSE if the ring is full.
+ */
+gboolean
+gst_dabplus_ring_push (GstDabPlusRing * ring, gpointer item)
+{
+  guint head = ring->head;
+
+  g_return_val_if_fail (item != NULL, FALSE);
+
+  if (head - (guint) g_atomic_int_get (&ring->tail) > ring->mask)
+    return FALSE;
+
+  ring->slots[head & ring->mask] = item;
+  g_atomic_int_set (&ring->head, head + 1);
+
+  return TRUE;
+}
+
+/**
+ * gst_dabplus_ring_pop:
+ * @ring: #GstDabPlusRing.
+ *
+ * Takes the item from the beginning of the ring.
+ * To be called by the consumer only.
+ *
+ * Returns: The item or NULL if the ring is empty.
+ */
+gpointer
+gst_dabplus_ring_pop (GstDabPlusRing * ring)
+{
+  guint tail = ring->tail;
+  gpointer item;
+
+  if (tail == (guint) g_atomic_int_get (&ring->head))
+    return NULL;
+
+  item = ring->slots[tail & ring->mask];
+  g_atomic_int_set (&ring->tail, tail + 1);
+
+  return item;
+}
@@ -0,0 +1,40 @@
+/* GStreamer DAB Plus single producer, single consumer ring
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DABPLUSRING_H__
+#define __GST_DABPLUSRING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstDabPlusRing GstDabPlusRing;
+
+GstDabPlusRing *gst_dabplus_ring_new (guint size);
+
+void gst_dabplus_ring_free (GstDabPlusRing * ring);
+
+gboolean gst_dabplus_ring_push (GstDabPlusRing * ring, gpointer item);
+
+gpointer gst_dabplus_ring_pop (GstDabPlusRing * ring);
+
+G_END_DECLS
+
+#endif /* __GST_DABPLUSRING_H__ */
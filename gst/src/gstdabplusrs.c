@@ -0,0 +1,691 @@
+/* GStreamer DAB Plus Reed-Solomon decoder
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * DAB+ superframes are protected by a shortened RS(120, 110, t = 5) code
+ * (ETSI TS 102 563, clause 6). The code is defined over GF(2^8) with the
+ * field generator polynomial x^8 + x^4 + x^3 + x^2 + 1 and the code
+ * generator polynomial (x + a^0)(x + a^1)...(x + a^9).
+ *
+ * A superframe of n * 120 bytes is virtually interleaved: codeword 'j'
+ * (0 <= j < n) consists of bytes j, j + n, j + 2n, ... of the superframe.
+ * The first 110 * n bytes carry the audio super frame,
+ * the last 10 * n bytes carry the parity.
+ *
+ * Syndromes are computed for all codewords of a superframe at once,
+ * walking the superframe row by row (row 'k' holds byte 'k' of every
+ * codeword), so that each vector lane serves one codeword. Multiplication
+ * by the constants a^i is done with lookup tables in the portable kernel,
+ * with split-nibble PSHUFB lookups in the SSSE3/AVX2 kernels and with
+ * a single GF2P8AFFINEQB per vector in the GFNI kernel. GF2P8MULB cannot be
+ * used directly, as it works in the AES field (x^8 + x^4 + x^3 + x + 1).
+ * The remaining steps (Berlekamp-Massey, Chien, Forney) are only run for
+ * codewords with non zero syndromes and are kept portable.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstdabplusrs.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DABPLUS_RS_X86 1
+#include <immintrin.h>
+#endif
+
+#define GF_POLYNOMIAL          0x11d
+#define RS_MAX_INTERLEAVE      216  /* codewords per superframe of the highest bitrate */
+#define RS_SYNDROME_STRIDE     256  /* RS_MAX_INTERLEAVE plus room for vector stores and folding */
+
+/* s[i][j] holds syndrome 'i' of codeword 'j' */
+typedef void (*GstDabPlusRsSyndromesFunc) (const guint8 * data, guint n,
+    guint8 (*s)[RS_SYNDROME_STRIDE]);
+
+typedef struct {
+  const gchar *syndromes_name;
+  GstDabPlusRsSyndromesFunc syndromes;
+} GstDabPlusRsKernels;
+
+static guint8 gst_dabplus_gf_exp[2 * 255];
+static guint8 gst_dabplus_gf_log[256];
+
+/* Multiplication by a^i, filled in by gst_dabplus_rs_init() */
+static guint8 gst_dabplus_gf_mul_alpha[RS_PARITY_LENGTH][256];
+
+#ifdef DABPLUS_RS_X86
+/* Split-nibble tables for multiplication by a^e.
+   Indexed as [e][nibble: 0 - low, 1 - high][nibble value] */
+static guint8 gst_dabplus_gf_nibble_table[255][2][16]
+    __attribute__ ((aligned (16)));
+
+/* GF2P8AFFINEQB matrices for multiplication by a^e */
+static guint64 gst_dabplus_gf_affine_table[255];
+#endif
+
+static inline guint8
+gst_dabplus_gf_mul (guint8 a, guint8 b)
+{
+  if ((a == 0) || (b == 0))
+    return 0;
+
+  return gst_dabplus_gf_exp[gst_dabplus_gf_log[a] + gst_dabplus_gf_log[b]];
+}
+
+static inline guint8
+gst_dabplus_gf_div (guint8 a, guint8 b)
+{
+  if (a == 0)
+    return 0;
+
+  return gst_dabplus_gf_exp[gst_dabplus_gf_log[a] + 255 - gst_dabplus_gf_log[b]];
+}
+
+/* Evaluates polynomial p (p[0] is the constant term) of degree < n
+   at point a^e */
+static guint8
+gst_dabplus_gf_poly_eval (const guint8 * p, guint n, guint e)
+{
+  guint8 value = 0;
+  guint i;
+
+  e %= 255;
+
+  for (i = n; i-- > 0; )
+    value = gst_dabplus_gf_mul (value, gst_dabplus_gf_exp[e]) ^ p[i];
+
+  return value;
+}
+
+static void
+gst_dabplus_rs_syndromes_portable (const guint8 * data, guint n,
+    guint8 (*s)[RS_SYNDROME_STRIDE])
+{
+  guint i, j, k;
+
+  for (i = 0; i < RS_PARITY_LENGTH; ++i)
+    memset (s[i], 0, n);
+
+  for (k = 0; k < RS_CODEWORD_LENGTH; ++k) {
+    const guint8 *row = data + k * n;
+
+    for (j = 0; j < n; ++j)
+      s[0][j] ^= row[j];
+
+    for (i = 1; i < RS_PARITY_LENGTH; ++i) {
+      const guint8 *mul = gst_dabplus_gf_mul_alpha[i];
+
+      for (j = 0; j < n; ++j)
+        s[i][j] = mul[s[i][j]] ^ row[j];
+    }
+  }
+}
+
+#ifdef DABPLUS_RS_X86
+
+/* Vector kernels pack 'm' consecutive rows of the superframe into one vector
+   when codewords do not fill it up (low bitrates). Lane 'r * n + j' then
+   serves row 'r' of every group of 'm' rows of codeword 'j', so stepping
+   from one group to the next one multiplies all lanes by the same a^(i * m).
+   Finally, the 'm' partial syndromes of each codeword are folded together
+   by a Horner scheme over lanes shifted by 'n'.
+   'm' has to divide RS_CODEWORD_LENGTH. */
+static guint
+gst_dabplus_rs_rows_per_vector (guint n, guint width)
+{
+  static const guint8 divisors[] = {
+    120, 60, 40, 30, 24, 20, 15, 12, 10, 8, 6, 5, 4, 3, 2
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (divisors); ++i)
+    if (divisors[i] * n <= width)
+      return divisors[i];
+
+  return 1;
+}
+
+/* Loads of the last rows could reach past the end of the superframe,
+   those are served from a padded copy. */
+#define RS_LOAD_ROWS(type, load, width, data, size, offset, tail)                \
+  (G_LIKELY ((offset) + (width) <= (size)) ?                                     \
+    load ((const type *) ((data) + (offset))) :                                  \
+    (memcpy ((tail), (data) + (offset), MIN ((width), (size) - (offset))),       \
+     load ((const type *) (tail))))
+
+__attribute__ ((target ("ssse3")))
+static void
+gst_dabplus_rs_syndromes_ssse3 (const guint8 * data, guint n,
+    guint8 (*s)[RS_SYNDROME_STRIDE])
+{
+  const __m128i nibble_mask = _mm_set1_epi8 (0x0f);
+  const guint size = RS_CODEWORD_LENGTH * n;
+  const guint m = gst_dabplus_rs_rows_per_vector (n, 16);
+  __m128i lo_table[RS_PARITY_LENGTH], hi_table[RS_PARITY_LENGTH];
+  guint8 tail[16];
+  guint i, j, k;
+
+  for (i = 1; i < RS_PARITY_LENGTH; ++i) {
+    const guint e = (i * m) % 255;
+    lo_table[i] = _mm_load_si128 ((const __m128i *) gst_dabplus_gf_nibble_table[e][0]);
+    hi_table[i] = _mm_load_si128 ((const __m128i *) gst_dabplus_gf_nibble_table[e][1]);
+  }
+
+  for (j = 0; j < n; j += 16) {
+    __m128i acc[RS_PARITY_LENGTH];
+
+    for (i = 0; i < RS_PARITY_LENGTH; ++i)
+      acc[i] = _mm_setzero_si128 ();
+
+    for (k = 0; k < RS_CODEWORD_LENGTH; k += m) {
+      const __m128i v = RS_LOAD_ROWS (__m128i, _mm_loadu_si128, 16,
+          data, size, k * n + j, tail);
+
+      acc[0] = _mm_xor_si128 (acc[0], v);
+
+      for (i = 1; i < RS_PARITY_LENGTH; ++i) {
+        const __m128i lo = _mm_and_si128 (acc[i], nibble_mask);
+        const __m128i hi = _mm_and_si128 (_mm_srli_epi16 (acc[i], 4), nibble_mask);
+
+        acc[i] = _mm_xor_si128 (v, _mm_xor_si128 (
+            _mm_shuffle_epi8 (lo_table[i], lo), _mm_shuffle_epi8 (hi_table[i], hi)));
+      }
+    }
+
+    for (i = 0; i < RS_PARITY_LENGTH; ++i)
+      _mm_storeu_si128 ((__m128i *) (s[i] + j), acc[i]);
+  }
+
+  if (m > 1) {
+    for (i = 0; i < RS_PARITY_LENGTH; ++i) {
+      const __m128i lo_fold = _mm_load_si128 ((const __m128i *) gst_dabplus_gf_nibble_table[i][0]);
+      const __m128i hi_fold = _mm_load_si128 ((const __m128i *) gst_dabplus_gf_nibble_table[i][1]);
+      __m128i t = _mm_loadu_si128 ((const __m128i *) s[i]);
+
+      for (k = 1; k < m; ++k) {
+        const __m128i lo = _mm_and_si128 (t, nibble_mask);
+        const __m128i hi = _mm_and_si128 (_mm_srli_epi16 (t, 4), nibble_mask);
+
+        t = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (s[i] + k * n)),
+            _mm_xor_si128 (_mm_shuffle_epi8 (lo_fold, lo), _mm_shuffle_epi8 (hi_fold, hi)));
+      }
+
+      _mm_storeu_si128 ((__m128i *) s[i], t);
+    }
+  }
+}
+
+__attribute__ ((target ("avx2")))
+static void
+gst_dabplus_rs_syndromes_avx2 (const guint8 * data, guint n,
+    guint8 (*s)[RS_SYNDROME_STRIDE])
+{
+  const __m256i nibble_mask = _mm256_set1_epi8 (0x0f);
+  const guint size = RS_CODEWORD_LENGTH * n;
+  const guint m = gst_dabplus_rs_rows_per_vector (n, 32);
+  __m256i lo_table[RS_PARITY_LENGTH], hi_table[RS_PARITY_LENGTH];
+  guint8 tail[32];
+  guint i, j, k;
+
+  for (i = 1; i < RS_PARITY_LENGTH; ++i) {
+    const guint e = (i * m) % 255;
+    lo_table[i] = _mm256_broadcastsi128_si256 (
+        _mm_load_si128 ((const __m128i *) gst_dabplus_gf_nibble_table[e][0]));
+    hi_table[i] = _mm256_broadcastsi128_si256 (
+        _mm_load_si128 ((const __m128i *) gst_dabplus_gf_nibble_table[e][1]));
+  }
+
+  for (j = 0; j < n; j += 32) {
+    __m256i acc[RS_PARITY_LENGTH];
+
+    for (i = 0; i < RS_PARITY_LENGTH; ++i)
+      acc[i] = _mm256_setzero_si256 ();
+
+    for (k = 0; k < RS_CODEWORD_LENGTH; k += m) {
+      const __m256i v = RS_LOAD_ROWS (__m256i, _mm256_loadu_si256, 32,
+          data, size, k * n + j, tail);
+
+      acc[0] = _mm256_xor_si256 (acc[0], v);
+
+      for (i = 1; i < RS_PARITY_LENGTH; ++i) {
+        const __m256i lo = _mm256_and_si256 (acc[i], nibble_mask);
+        const __m256i hi = _mm256_and_si256 (_mm256_srli_epi16 (acc[i], 4), nibble_mask);
+
+        acc[i] = _mm256_xor_si256 (v, _mm256_xor_si256 (
+            _mm256_shuffle_epi8 (lo_table[i], lo), _mm256_shuffle_epi8 (hi_table[i], hi)));
+      }
+    }
+
+    for (i = 0; i < RS_PARITY_LENGTH; ++i)
+      _mm256_storeu_si256 ((__m256i *) (s[i] + j), acc[i]);
+  }
+
+  if (m > 1) {
+    for (i = 0; i < RS_PARITY_LENGTH; ++i) {
+      const __m256i lo_fold = _mm256_broadcastsi128_si256 (
+          _mm_load_si128 ((const __m128i *) gst_dabplus_gf_nibble_table[i][0]));
+      const __m256i hi_fold = _mm256_broadcastsi128_si256 (
+          _mm_load_si128 ((const __m128i *) gst_dabplus_gf_nibble_table[i][1]));
+      __m256i t = _mm256_loadu_si256 ((const __m256i *) s[i]);
+
+      for (k = 1; k < m; ++k) {
+        const __m256i lo = _mm256_and_si256 (t, nibble_mask);
+        const __m256i hi = _mm256_and_si256 (_mm256_srli_epi16 (t, 4), nibble_mask);
+
+        t = _mm256_xor_si256 (_mm256_loadu_si256 ((const __m256i *) (s[i] + k * n)),
+            _mm256_xor_si256 (_mm256_shuffle_epi8 (lo_fold, lo), _mm256_shuffle_epi8 (hi_fold, hi)));
+      }
+
+      _mm256_storeu_si256 ((__m256i *) s[i], t);
+    }
+  }
+}
+
+__attribute__ ((target ("gfni,avx2")))
+static void
+gst_dabplus_rs_syndromes_gfni (const guint8 * data, guint n,
+    guint8 (*s)[RS_SYNDROME_STRIDE])
+{
+  const guint size = RS_CODEWORD_LENGTH * n;
+  const guint m = gst_dabplus_rs_rows_per_vector (n, 32);
+  __m256i matrix[RS_PARITY_LENGTH];
+  guint8 tail[32];
+  guint i, j, k;
+
+  for (i = 1; i < RS_PARITY_LENGTH; ++i)
+    matrix[i] = _mm256_set1_epi64x (gst_dabplus_gf_affine_table[(i * m) % 255]);
+
+  for (j = 0; j < n; j += 32) {
+    __m256i acc[RS_PARITY_LENGTH];
+
+    for (i = 0; i < RS_PARITY_LENGTH; ++i)
+      acc[i] = _mm256_setzero_si256 ();
+
+    for (k = 0; k < RS_CODEWORD_LENGTH; k += m) {
+      const __m256i v = RS_LOAD_ROWS (__m256i, _mm256_loadu_si256, 32,
+          data, size, k * n + j, tail);
+
+      acc[0] = _mm256_xor_si256 (acc[0], v);
+
+      for (i = 1; i < RS_PARITY_LENGTH; ++i)
+        acc[i] = _mm256_xor_si256 (v,
+            _mm256_gf2p8affine_epi64_epi8 (acc[i], matrix[i], 0));
+    }
+
+    for (i = 0; i < RS_PARITY_LENGTH; ++i)
+      _mm256_storeu_si256 ((__m256i *) (s[i] + j), acc[i]);
+  }
+
+  if (m > 1) {
+    for (i = 0; i < RS_PARITY_LENGTH; ++i) {
+      const __m256i fold = _mm256_set1_epi64x (gst_dabplus_gf_affine_table[i]);
+      __m256i t = _mm256_loadu_si256 ((const __m256i *) s[i]);
+
+      for (k = 1; k < m; ++k)
+        t = _mm256_xor_si256 (_mm256_loadu_si256 ((const __m256i *) (s[i] + k * n)),
+            _mm256_gf2p8affine_epi64_epi8 (t, fold, 0));
+
+      _mm256_storeu_si256 ((__m256i *) s[i], t);
+    }
+  }
+}
+
+#endif /* DABPLUS_RS_X86 */
+
+static GstDabPlusRsKernels gst_dabplus_rs_kernels = {
+  "portable", gst_dabplus_rs_syndromes_portable
+};
+
+/**
+ * gst_dabplus_rs_decode_codeword:
+ * @cw: Codeword to be corrected in place.
+ * @s: Syndromes of @cw (at least one of them is not zero).
+ * @erasures: Positions (byte indexes) of erased bytes within @cw.
+ * @n_erasures: Number of @erasures, at most RS_PARITY_LENGTH.
+ *
+ * Berlekamp-Massey, initialized with the erasure locator, finds the errata
+ * (errors and erasures) locator, Chien search its roots and Forney
+ * algorithm the errata values. Up to 'e' erasures and 'v' errors
+ * are corrected as long as 2v + e <= RS_PARITY_LENGTH.
+ *
+ * Returns: Number of corrected bytes or -1 if the codeword is uncorrectable.
+ */
+static gint
+gst_dabplus_rs_decode_codeword (guint8 * cw, const guint8 * s,
+    const guint8 * erasures, guint n_erasures)
+{
+  guint8 lambda[RS_PARITY_LENGTH + 1] = { 1 };
+  guint8 b[RS_PARITY_LENGTH + 1];
+  guint8 t[RS_PARITY_LENGTH + 1];
+  guint8 omega[RS_PARITY_LENGTH];
+  guint8 terms[RS_PARITY_LENGTH + 1];
+  guint8 positions[RS_PARITY_LENGTH];
+  guint8 values[RS_PARITY_LENGTH];
+  guint l = n_erasures;
+  guint r, n, i, k;
+  guint n_errata, n_corrected;
+
+  /* Erasure locator: product of (1 + X * x) over erased bytes,
+     byte 'k' of the codeword having locator X = a^(119 - k) */
+  for (i = 0; i < n_erasures; ++i) {
+    const guint8 x = gst_dabplus_gf_exp[RS_CODEWORD_LENGTH - 1 - erasures[i]];
+
+    for (k = i + 1; k > 0; --k)
+      lambda[k] ^= gst_dabplus_gf_mul (lambda[k - 1], x);
+  }
+
+  memcpy (b, lambda, sizeof (b));
+
+  /* Berlekamp-Massey */
+  for (r = n_erasures + 1; r <= RS_PARITY_LENGTH; ++r) {
+    guint8 d = 0;
+
+    for (i = 0; i < r; ++i)
+      d ^= gst_dabplus_gf_mul (lambda[i], s[r - 1 - i]);
+
+    /* t(x) = lambda(x) - d * x * b(x) */
+    t[0] = lambda[0];
+    for (i = 1; i <= RS_PARITY_LENGTH; ++i)
+      t[i] = lambda[i] ^ gst_dabplus_gf_mul (d, b[i - 1]);
+
+    if ((d != 0) && (2 * l <= r - 1 + n_erasures)) {
+      /* b(x) = lambda(x) / d */
+      for (i = 0; i <= RS_PARITY_LENGTH; ++i)
+        b[i] = gst_dabplus_gf_div (lambda[i], d);
+      l = r - l + n_erasures;
+    } else {
+      /* b(x) = x * b(x) */
+      memmove (b + 1, b, RS_PARITY_LENGTH);
+      b[0] = 0;
+    }
+
+    memcpy (lambda, t, sizeof (lambda));
+  }
+
+  if ((l > RS_PARITY_LENGTH) || (2 * l > RS_PARITY_LENGTH + n_erasures))
+    return -1;
+
+  /* Chien search, limited to the positions of the shortened code.
+     Byte 'k' of the codeword is the coefficient of x^(119 - k),
+     its error locator is a^(119 - k). Terms lambda[i] * a^(-(119 - k) * i)
+     are multiplied by a^i when moving to the next byte. */
+  for (i = 1; i <= l; ++i)
+    terms[i] = gst_dabplus_gf_mul (lambda[i],
+      gst_dabplus_gf_exp[(RS_PARITY_LENGTH * 255 - (RS_CODEWORD_LENGTH - 1) * i) % 255]);
+
+  n_errata = 0;
+  for (k = 0; k < RS_CODEWORD_LENGTH; ++k) {
+    guint8 value = lambda[0];
+
+    for (i = 1; i <= l; ++i) {
+      value ^= terms[i];
+      terms[i] = gst_dabplus_gf_mul (terms[i], gst_dabplus_gf_exp[i]);
+    }
+
+    if (value == 0) {
+      if (n_errata == l)
+        return -1;
+      positions[n_errata++] = k;
+    }
+  }
+
+  if (n_errata != l)
+    return -1;
+
+  /* omega(x) = s(x) * lambda(x) mod x^(2t) */
+  for (i = 0; i < RS_PARITY_LENGTH; ++i) {
+    omega[i] = 0;
+    for (n = 0; n <= MIN (i, l); ++n)
+      omega[i] ^= gst_dabplus_gf_mul (lambda[n], s[i - n]);
+  }
+
+  /* Forney, for the first consecutive root being a^0:
+     e = X * omega(X^-1) / lambda'(X^-1) */
+  for (i = 0; i < n_errata; ++i) {
+    guint power = RS_CODEWORD_LENGTH - 1 - positions[i];
+    guint inverse = 255 - power;
+    guint8 numerator, denominator = 0;
+
+    numerator = gst_dabplus_gf_mul (gst_dabplus_gf_exp[power],
+      gst_dabplus_gf_poly_eval (omega, RS_PARITY_LENGTH, inverse));
+
+    /* formal derivative keeps odd powers only */
+    for (n = 1; n <= l; n += 2)
+      denominator ^= gst_dabplus_gf_mul (lambda[n],
+        gst_dabplus_gf_exp[(inverse * (n - 1)) % 255]);
+
+    if (denominator == 0)
+      return -1;
+
+    values[i] = gst_dabplus_gf_div (numerator, denominator);
+  }
+
+  /* erased bytes might have been right after all */
+  n_corrected = 0;
+  for (i = 0; i < n_errata; ++i) {
+    if (values[i]) {
+      cw[positions[i]] ^= values[i];
+      ++n_corrected;
+    }
+  }
+
+  return n_corrected;
+}
+
+static void
+gst_dabplus_rs_init_tables (void)
+{
+  guint x = 1;
+  guint i, j;
+
+  for (i = 0; i < 255; ++i) {
+    gst_dabplus_gf_exp[i] = gst_dabplus_gf_exp[i + 255] = x;
+    gst_dabplus_gf_log[x] = i;
+    x <<= 1;
+    if (x & 0x100)
+      x ^= GF_POLYNOMIAL;
+  }
+
+  for (i = 0; i < RS_PARITY_LENGTH; ++i)
+    for (j = 0; j < 256; ++j)
+      gst_dabplus_gf_mul_alpha[i][j] = gst_dabplus_gf_mul (gst_dabplus_gf_exp[i], j);
+
+#ifdef DABPLUS_RS_X86
+  for (i = 0; i < 255; ++i) {
+    const guint8 c = gst_dabplus_gf_exp[i];
+    guint64 matrix = 0;
+    guint bit;
+
+    for (j = 0; j < 16; ++j) {
+      gst_dabplus_gf_nibble_table[i][0][j] = gst_dabplus_gf_mul (c, j);
+      gst_dabplus_gf_nibble_table[i][1][j] = gst_dabplus_gf_mul (c, j << 4);
+    }
+
+    /* Byte '7 - bit' of the matrix selects the input bits
+       contributing to output bit 'bit' */
+    for (bit = 0; bit < 8; ++bit) {
+      guint row = 0;
+
+      for (j = 0; j < 8; ++j)
+        row |= ((gst_dabplus_gf_mul (c, 1 << j) >> bit) & 1) << j;
+
+      matrix |= (guint64) row << (8 * (7 - bit));
+    }
+
+    gst_dabplus_gf_affine_table[i] = matrix;
+  }
+#endif
+}
+
+/**
+ * gst_dabplus_rs_init:
+ *
+ * Initializes GF(2^8) lookup tables and selects the best syndrome kernel
+ * supported by the CPU we are running on. Has to be called (once is enough)
+ * before any other gst_dabplus_rs_* function is used.
+ *
+ * Returns: None.
+ */
+void
+gst_dabplus_rs_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    gst_dabplus_rs_init_tables ();
+
+#ifdef DABPLUS_RS_X86
+    __builtin_cpu_init ();
+
+    if (__builtin_cpu_supports ("gfni") && __builtin_cpu_supports ("avx2")) {
+      gst_dabplus_rs_kernels.syndromes_name = "gfni";
+      gst_dabplus_rs_kernels.syndromes = gst_dabplus_rs_syndromes_gfni;
+    } else if (__builtin_cpu_supports ("avx2")) {
+      gst_dabplus_rs_kernels.syndromes_name = "avx2";
+      gst_dabplus_rs_kernels.syndromes = gst_dabplus_rs_syndromes_avx2;
+    } else if (__builtin_cpu_supports ("ssse3")) {
+      gst_dabplus_rs_kernels.syndromes_name = "ssse3";
+      gst_dabplus_rs_kernels.syndromes = gst_dabplus_rs_syndromes_ssse3;
+    }
+#endif
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/**
+ * gst_dabplus_rs_get_kernel_name:
+ *
+ * Tells which syndrome kernel was selected by gst_dabplus_rs_init().
+ *
+ * Returns: Name of the kernel.
+ */
+const gchar *
+gst_dabplus_rs_get_kernel_name (void)
+{
+  return gst_dabplus_rs_kernels.syndromes_name;
+}
+
+/**
+ * gst_dabplus_rs_check_superframe:
+ * @data: Superframe.
+ * @size: Size of the superframe (multiple of RS_CODEWORD_LENGTH).
+ *
+ * Returns: TRUE if none of the codewords of the superframe contains errors.
+ */
+gboolean
+gst_dabplus_rs_check_superframe (const guint8 * data, guint size)
+{
+  guint8 s[RS_PARITY_LENGTH][RS_SYNDROME_STRIDE];
+  guint n = size / RS_CODEWORD_LENGTH;
+  guint8 acc = 0;
+  guint i, j;
+
+  g_return_val_if_fail (n <= RS_MAX_INTERLEAVE, FALSE);
+
+  gst_dabplus_rs_kernels.syndromes (data, n, s);
+
+  for (i = 0; i < RS_PARITY_LENGTH; ++i)
+    for (j = 0; j < n; ++j)
+      acc |= s[i][j];
+
+  return acc == 0;
+}
+
+/**
+ * gst_dabplus_rs_correct_superframe:
+ * @data: Superframe to be corrected in place.
+ * @size: Size of the superframe (multiple of RS_CODEWORD_LENGTH).
+ * @erasures: Optional (may be NULL) @size flags, non zero flag
+ *            marks the corresponding byte of @data as erased.
+ * @corrected: Set to the number of corrected bytes.
+ *
+ * Codewords which cannot be corrected are left untouched.
+ * Erasure flags are ignored for codewords with more than
+ * RS_PARITY_LENGTH erased bytes.
+ *
+ * Returns: TRUE if all codewords of the superframe are free of errors
+ *          (possibly after correction).
+ */
+gboolean
+gst_dabplus_rs_correct_superframe (guint8 * data, guint size,
+    const guint8 * erasures, guint * corrected)
+{
+  guint8 s[RS_PARITY_LENGTH][RS_SYNDROME_STRIDE];
+  guint8 cw[RS_CODEWORD_LENGTH];
+  guint8 syndromes[RS_PARITY_LENGTH];
+  guint8 erased[RS_PARITY_LENGTH];
+  guint n = size / RS_CODEWORD_LENGTH;
+  gboolean retval = TRUE;
+  guint i, j, k;
+
+  *corrected = 0;
+
+  g_return_val_if_fail (n <= RS_MAX_INTERLEAVE, FALSE);
+
+  gst_dabplus_rs_kernels.syndromes (data, n, s);
+
+  for (j = 0; j < n; ++j) {
+    guint8 acc = 0;
+    guint n_erased = 0;
+    gint errors;
+
+    for (i = 0; i < RS_PARITY_LENGTH; ++i)
+      acc |= syndromes[i] = s[i][j];
+
+    if (acc == 0)
+      continue;
+
+    for (k = 0; k < RS_CODEWORD_LENGTH; ++k)
+      cw[k] = data[j + n * k];
+
+    if (erasures) {
+      for (k = 0; k < RS_CODEWORD_LENGTH; ++k) {
+        if (erasures[j + n * k]) {
+          if (n_erased == RS_PARITY_LENGTH) {
+            n_erased = 0;
+            break;
+          }
+          erased[n_erased++] = k;
+        }
+      }
+    }
+
+    errors = gst_dabplus_rs_decode_codeword (cw, syndromes, erased, n_erased);
+    if ((errors < 0) && (n_erased > 0)) {
+      /* hints might have been wrong, try without them */
+      errors = gst_dabplus_rs_decode_codeword (cw, syndromes, erased, 0);
+    }
+
+    if (errors < 0) {
+      retval = FALSE;
+      continue;
+    }
+
+    for (k = 0; k < RS_CODEWORD_LENGTH; ++k)
+      data[j + n * k] = cw[k];
+
+    *corrected += errors;
+  }
+
+  return retval;
+}
@@ -0,0 +1,42 @@
+/* GStreamer DAB Plus Reed-Solomon decoder
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DABPLUSRS_H__
+#define __GST_DABPLUSRS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define RS_CODEWORD_LENGTH     120  /* RS(120, 110) shortened from RS(255, 245) */
+#define RS_PARITY_LENGTH       10   /* 2 * t, where t = 5 */
+
+void gst_dabplus_rs_init (void);
+
+const gchar *gst_dabplus_rs_get_kernel_name (void);
+
+gboolean gst_dabplus_rs_check_superframe (const guint8 * data, guint size);
+
+gboolean gst_dabplus_rs_correct_superframe (guint8 * data, guint size,
+    const guint8 * erasures, guint * corrected);
+
+G_END_DECLS
+
+#endif /* __GST_DABPLUSRS_H__ */
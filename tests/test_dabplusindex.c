@@ -0,0 +1,306 @@
+/* GStreamer DAB Plus superframe index tests
+ *
+ * Copyright (C) 2020 Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "gstdabplusindex.h"
+
+#define SUPERFRAME_SIZE   360
+#define N_ENTRIES         200 /* spans several checkpoints */
+#define RECORDING_SIZE    G_GUINT64_CONSTANT (123456)
+#define HEADER_LENGTH     24
+
+typedef struct {
+  gchar *dir;
+  gchar *location;
+  GstDabPlusIndexEntry entries[N_ENTRIES];
+} Fixture;
+
+/* Continuous superframes with a gap, a resynchronisation behind the
+   expected offset, a timestamp jitter backwards and a time jump */
+static void
+fixture_make_entries (Fixture * fixture)
+{
+  guint64 offset = 17;
+  guint64 pts = 0;
+  guint i;
+
+  for (i = 0; i < N_ENTRIES; ++i) {
+    if (i == 63)
+      offset += 5 * SUPERFRAME_SIZE + 11;
+    else if (i == 64)
+      offset -= 100;
+    else if (i == 130)
+      pts -= GST_DABPLUS_INDEX_SUPERFRAME_DURATION / 2;
+    else if (i == 150)
+      pts += 60 * GST_DABPLUS_INDEX_SUPERFRAME_DURATION;
+
+    fixture->entries[i].offset = offset;
+    fixture->entries[i].pts = pts;
+    fixture->entries[i].flags = (i % 7) ? 0 :
+      GST_DABPLUS_INDEX_FLAG_RS_CORRECTED | ((i % 14) ? 0 :
+        GST_DABPLUS_INDEX_FLAG_AU_CRC_ERRORS);
+
+    offset += SUPERFRAME_SIZE;
+    pts += GST_DABPLUS_INDEX_SUPERFRAME_DURATION;
+  }
+}
+
+static void
+fixture_write (Fixture * fixture, guint n_entries)
+{
+  GstDabPlusIndexWriter *writer;
+  guint i;
+
+  writer = gst_dabplus_index_writer_new (fixture->location, SUPERFRAME_SIZE);
+  g_assert_nonnull (writer);
+
+  for (i = 0; i < n_entries; ++i)
+    g_assert_true (gst_dabplus_index_writer_add (writer, &fixture->entries[i]));
+
+  g_assert_true (gst_dabplus_index_writer_finish (writer, RECORDING_SIZE));
+}
+
+static void
+fixture_setup (Fixture * fixture, gconstpointer user_data)
+{
+  fixture->dir = g_dir_make_tmp ("dabplusindex-XXXXXX", NULL);
+  g_assert_nonnull (fixture->dir);
+  fixture->location = g_build_filename (fixture->dir, "index", NULL);
+  fixture_make_entries (fixture);
+}
+
+static void
+fixture_teardown (Fixture * fixture, gconstpointer user_data)
+{
+  g_unlink (fixture->location);
+  g_rmdir (fixture->dir);
+  g_free (fixture->location);
+  g_free (fixture->dir);
+}
+
+static void
+assert_entry (const GstDabPlusIndexEntry * entry,
+    const GstDabPlusIndexEntry * expected)
+{
+  g_assert_cmpuint (entry->offset, ==, expected->offset);
+  g_assert_cmpuint (entry->pts, ==, expected->pts);
+  g_assert_cmpuint (entry->flags, ==, expected->flags);
+}
+
+static void
+test_round_trip (Fixture * fixture, gconstpointer user_data)
+{
+  GstDabPlusIndex *index;
+  GstDabPlusIndexEntry entry;
+  guint i;
+
+  fixture_write (fixture, N_ENTRIES);
+
+  index = gst_dabplus_index_open (fixture->location);
+  g_assert_nonnull (index);
+  g_assert_cmpuint (gst_dabplus_index_get_superframe_size (index), ==, SUPERFRAME_SIZE);
+  g_assert_cmpuint (gst_dabplus_index_get_n_entries (index), ==, N_ENTRIES);
+  g_assert_cmpuint (gst_dabplus_index_get_recording_size (index), ==, RECORDING_SIZE);
+
+  /* backwards, so that every entry is decoded from its checkpoint */
+  for (i = N_ENTRIES; i-- > 0;) {
+    g_assert_true (gst_dabplus_index_get_entry (index, i, &entry));
+    assert_entry (&entry, &fixture->entries[i]);
+  }
+
+  g_assert_false (gst_dabplus_index_get_entry (index, N_ENTRIES, &entry));
+
+  /* a reference keeps the index usable after the owner released it */
+  gst_dabplus_index_ref (index);
+  gst_dabplus_index_unref (index);
+  g_assert_true (gst_dabplus_index_get_entry (index, N_ENTRIES - 1, &entry));
+  assert_entry (&entry, &fixture->entries[N_ENTRIES - 1]);
+  gst_dabplus_index_unref (index);
+}
+
+static void
+test_empty (Fixture * fixture, gconstpointer user_data)
+{
+  GstDabPlusIndex *index;
+  GstDabPlusIndexEntry entry;
+
+  fixture_write (fixture, 0);
+
+  index = gst_dabplus_index_open (fixture->location);
+  g_assert_nonnull (index);
+  g_assert_cmpuint (gst_dabplus_index_get_n_entries (index), ==, 0);
+  g_assert_false (gst_dabplus_index_get_entry (index, 0, &entry));
+  g_assert_false (gst_dabplus_index_find_by_time (index, 0, &entry));
+  g_assert_false (gst_dabplus_index_find_by_offset (index, 0, &entry));
+  gst_dabplus_index_unref (index);
+}
+
+static void
+test_find (Fixture * fixture, gconstpointer user_data)
+{
+  GstDabPlusIndex *index;
+  GstDabPlusIndexEntry entry;
+  const GstDabPlusIndexEntry *entries = fixture->entries;
+  guint i;
+
+  fixture_write (fixture, N_ENTRIES);
+
+  index = gst_dabplus_index_open (fixture->location);
+  g_assert_nonnull (index);
+
+  for (i = 0; i < N_ENTRIES; ++i) {
+    /* exact hits */
+    g_assert_true (gst_dabplus_index_find_by_offset (index, entries[i].offset, &entry));
+    assert_entry (&entry, &entries[i]);
+    g_assert_true (gst_dabplus_index_find_by_time (index, entries[i].pts, &entry));
+    assert_entry (&entry, &entries[i]);
+
+    /* anything up to the next entry (or in a gap after it) maps to it */
+    g_assert_true (gst_dabplus_index_find_by_offset (index,
+        ((i + 1 < N_ENTRIES) ? entries[i + 1].offset : entries[i].offset +
+          10 * SUPERFRAME_SIZE) - 1, &entry));
+    assert_entry (&entry, &entries[i]);
+    g_assert_true (gst_dabplus_index_find_by_time (index,
+        ((i + 1 < N_ENTRIES) ? entries[i + 1].pts : G_MAXUINT64) - 1, &entry));
+    assert_entry (&entry, &entries[i]);
+  }
+
+  /* before the first superframe */
+  g_assert_true (gst_dabplus_index_find_by_offset (index, 0, &entry));
+  assert_entry (&entry, &entries[0]);
+
+  /* within the gap before entry 63 */
+  g_assert_true (gst_dabplus_index_find_by_offset (index,
+      entries[62].offset + 3 * SUPERFRAME_SIZE, &entry));
+  assert_entry (&entry, &entries[62]);
+
+  /* within the time jump before entry 150 */
+  g_assert_true (gst_dabplus_index_find_by_time (index,
+      entries[149].pts + 30 * GST_DABPLUS_INDEX_SUPERFRAME_DURATION, &entry));
+  assert_entry (&entry, &entries[149]);
+
+  gst_dabplus_index_unref (index);
+}
+
+static void
+test_writer_order (Fixture * fixture, gconstpointer user_data)
+{
+  GstDabPlusIndexWriter *writer;
+
+  writer = gst_dabplus_index_writer_new (fixture->location, SUPERFRAME_SIZE);
+  g_assert_nonnull (writer);
+  g_assert_true (gst_dabplus_index_writer_add (writer, &fixture->entries[1]));
+  g_assert_false (gst_dabplus_index_writer_add (writer, &fixture->entries[1]));
+  g_assert_false (gst_dabplus_index_writer_add (writer, &fixture->entries[0]));
+  gst_dabplus_index_writer_abort (writer);
+
+  g_assert_false (g_file_test (fixture->location, G_FILE_TEST_EXISTS));
+}
+
+static void
+test_reject (Fixture * fixture, gconstpointer user_data)
+{
+  GstDabPlusIndexWriter *writer;
+  GstDabPlusIndex *index;
+  gchar *contents, *modified;
+  gsize length;
+  guint i;
+
+  /* missing file */
+  g_assert_null (gst_dabplus_index_open (fixture->location));
+
+  /* still being written */
+  writer = gst_dabplus_index_writer_new (fixture->location, SUPERFRAME_SIZE);
+  g_assert_nonnull (writer);
+  for (i = 0; i < N_ENTRIES; ++i)
+    g_assert_true (gst_dabplus_index_writer_add (writer, &fixture->entries[i]));
+  g_assert_null (gst_dabplus_index_open (fixture->location));
+  gst_dabplus_index_writer_abort (writer);
+
+  fixture_write (fixture, N_ENTRIES);
+  g_assert_true (g_file_get_contents (fixture->location, &contents, &length, NULL));
+  g_assert_cmpuint (length, >, HEADER_LENGTH);
+
+  /* truncated anywhere, down to an incomplete header */
+  for (i = 0; i < length; i += (i < HEADER_LENGTH + 8) ? 1 : 37) {
+    g_assert_true (g_file_set_contents (fixture->location, contents, i, NULL));
+    index = gst_dabplus_index_open (fixture->location);
+    g_assert_null (index);
+  }
+  g_assert_true (g_file_set_contents (fixture->location, contents, length - 1, NULL));
+  g_assert_null (gst_dabplus_index_open (fixture->location));
+
+  /* trailing garbage */
+  modified = g_malloc (length + 1);
+  memcpy (modified, contents, length);
+  modified[length] = 0;
+  g_assert_true (g_file_set_contents (fixture->location, modified, length + 1, NULL));
+  g_assert_null (gst_dabplus_index_open (fixture->location));
+
+  /* complete flag cleared */
+  memcpy (modified, contents, length);
+  modified[5] = 0;
+  g_assert_true (g_file_set_contents (fixture->location, modified, length, NULL));
+  g_assert_null (gst_dabplus_index_open (fixture->location));
+
+  /* other version */
+  memcpy (modified, contents, length);
+  modified[4] = 1;
+  g_assert_true (g_file_set_contents (fixture->location, modified, length, NULL));
+  g_assert_null (gst_dabplus_index_open (fixture->location));
+
+  /* bad magic */
+  memcpy (modified, contents, length);
+  modified[0] = 'X';
+  g_assert_true (g_file_set_contents (fixture->location, modified, length, NULL));
+  g_assert_null (gst_dabplus_index_open (fixture->location));
+
+  /* intact again */
+  g_assert_true (g_file_set_contents (fixture->location, contents, length, NULL));
+  index = gst_dabplus_index_open (fixture->location);
+  g_assert_nonnull (index);
+  gst_dabplus_index_unref (index);
+
+  g_free (modified);
+  g_free (contents);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+#define ADD_TEST(path, func) \
+  g_test_add (path, Fixture, NULL, fixture_setup, func, fixture_teardown)
+
+  ADD_TEST ("/dabplusindex/round-trip", test_round_trip);
+  ADD_TEST ("/dabplusindex/empty", test_empty);
+  ADD_TEST ("/dabplusindex/find", test_find);
+  ADD_TEST ("/dabplusindex/writer-order", test_writer_order);
+  ADD_TEST ("/dabplusindex/reject", test_reject);
+
+#undef ADD_TEST
+
+  return g_test_run ();
+}